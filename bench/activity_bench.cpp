@@ -0,0 +1,79 @@
+#include "optimizer.h"
+#include "shape_eval.h"
+#include <chrono>
+#include <iostream>
+#include <algorithm>
+#include <cstdlib>
+
+// layer activity evaluation with the evaluator looked up on every
+// call, as GetActivity(acc, l) does, and resolved once per
+// accelerator, as Precompute and GetActivityFunc do
+
+static double Seconds(std::chrono::steady_clock::time_point start)
+{
+	std::chrono::duration<double> t = std::chrono::steady_clock::now() - start;
+	return t.count();
+}
+
+static double TimeLookup(Net &net, Accelerator &acc, int rounds, double &sum)
+{
+	auto start = std::chrono::steady_clock::now();
+	for (int r = 0; r < rounds; r++) {
+		for (int i = 0; i < net.size(); i++) {
+			sum += Optimizer::GetActivity(&acc, net[i])._cycle;
+		}
+	}
+	return Seconds(start);
+}
+
+static double TimeResolved(Optimizer &opt, Accelerator &acc, int rounds, double &sum)
+{
+	Net &net = opt._net;
+	auto start = std::chrono::steady_clock::now();
+	ActivityFunc func = opt.GetActivityFunc(&acc);
+	for (int r = 0; r < rounds; r++) {
+		for (int i = 0; i < net.size(); i++) {
+			sum -= Optimizer::GetActivity(func, &acc, net[i])._cycle;
+		}
+	}
+	return Seconds(start);
+}
+
+// best of 5 interleaved runs of each
+static void Bench(Optimizer &opt, Accelerator &acc, const char *name, int rounds)
+{
+	long long eval_num = (long long)rounds * opt._net.size();
+	double sum = 0;
+	double lookup = 1e30, resolved = 1e30;
+	for (int rep = 0; rep < 5; rep++) {
+		lookup = std::min(lookup, TimeLookup(opt._net, acc, rounds, sum));
+		resolved = std::min(resolved, TimeResolved(opt, acc, rounds, sum));
+	}
+
+	std::cout << name << ": lookup per call " << lookup / eval_num * 1e9 <<
+		" ns, resolved " << resolved / eval_num * 1e9 << " ns, speedup " <<
+		lookup / resolved << "x" << (sum == 0 ? "" : " (mismatch)") << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+	int rounds = (argc > 1) ? std::atoi(argv[1]) : 2000000;
+	Optimizer opt;
+	opt._verbose = false;
+	if (!opt.LoadNetFromFile(std::string(CEM_SOURCE_DIR) + "/model/vgg-16-conv.txt")) {
+		std::cout << "cannot load the network" << std::endl;
+		return 1;
+	}
+
+	Accelerator acc;
+	acc._pixel_p = 16;
+	acc._input_map_p = 16;
+	acc._output_map_p = 16;
+	acc._acc_buf._size = 32;
+	opt.Precompute(&acc);
+	Bench(opt, acc, "fixed shape 16x16x16 fifo 32", rounds / (int)opt._net.size());
+
+	acc._output_map_p = 12;
+	Bench(opt, acc, "runtime shape 16x16x12 fifo 32", rounds / (int)opt._net.size());
+	return 0;
+}
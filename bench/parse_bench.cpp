@@ -0,0 +1,46 @@
+#include "optimizer.h"
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <cstdlib>
+#include <algorithm>
+
+// loading a network of extended format lines, the MobileNet layers
+// repeated to the given layer number
+
+int main(int argc, char **argv)
+{
+	int layer_num = (argc > 1) ? std::atoi(argv[1]) : 1000000;
+	std::ifstream fs(std::string(CEM_SOURCE_DIR) + "/model/mobilenet-v1.txt");
+	std::string text((std::istreambuf_iterator<char>(fs)), std::istreambuf_iterator<char>());
+	Optimizer opt;
+	opt._verbose = false;
+	std::istringstream one(text);
+	if (!opt.LoadNet(one)) {
+		std::cout << "cannot load the network" << std::endl;
+		return 1;
+	}
+
+	std::string net;
+	int copies = (layer_num + opt._net.size() - 1) / opt._net.size();
+	for (int c = 0; c < copies; c++) {
+		net += text;
+	}
+
+	// best of 3
+	double best = 1e30;
+	for (int rep = 0; rep < 3; rep++) {
+		std::istringstream is(net);
+		auto start = std::chrono::steady_clock::now();
+		if (!opt.LoadNet(is)) {
+			std::cout << "cannot load the network" << std::endl;
+			return 1;
+		}
+		std::chrono::duration<double> t = std::chrono::steady_clock::now() - start;
+		best = std::min(best, t.count());
+	}
+	std::cout << opt._net.size() << " layers in " << best << " s, " <<
+		best / opt._net.size() * 1e9 << " ns per layer" << std::endl;
+	return 0;
+}
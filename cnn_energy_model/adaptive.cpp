@@ -0,0 +1,231 @@
+#include "adaptive.h"
+#include "profiler.h"
+#include <cmath>
+#include <queue>
+#include <set>
+#include <algorithm>
+#include <iterator>
+
+int DesignDim::Realize(double t)
+{
+	double v = _min + t * (_max - _min);
+	if (_pow2) {
+		v = std::pow(2.0, v);
+	}
+	return (int)std::floor(v + 0.5);
+}
+
+AdaptiveSweep::AdaptiveSweep(const std::vector<DesignDim> &dims, int budget)
+{
+	_dims = dims;
+	_budget = budget;
+	_tol = 0.05;
+	_max_level = 16;
+
+	// the finest coarse grid within 1/8 of the budget, at least
+	// the corners of the space
+	_coarse_level = 0;
+	while (_coarse_level < _max_level) {
+		double points = std::pow((1 << (_coarse_level + 1)) + 1.0, (double)dims.size());
+		if (points > budget / 8.0) {
+			break;
+		}
+		_coarse_level++;
+	}
+	_finest_level = 0;
+	_best = -1;
+}
+
+int AdaptiveSweep::_evalLattice(const std::vector<int> &u)
+{
+	std::vector<int> config(_dims.size());
+	for (int d = 0; d < _dims.size(); d++) {
+		config[d] = _dims[d].Realize((double)u[d] / (1 << _max_level));
+	}
+
+	// lattice points that round to the same configuration
+	// are only evaluated once
+	auto it = _index.find(config);
+	if (it != _index.end()) {
+		PROF_COUNT(PROF_DESIGN_DUP);
+		return it->second;
+	}
+	if (_points.size() >= _budget) {
+		return -1;
+	}
+	PROF_COUNT(PROF_DESIGN_EVAL);
+
+	DesignPoint p;
+	p._config = config;
+	p._ene = _eval(config.data());
+	_points.push_back(p);
+	_index[config] = _points.size() - 1;
+	_addPoint(_points.size() - 1);
+	return _points.size() - 1;
+}
+
+void AdaptiveSweep::_addPoint(int p)
+{
+	double total = _points[p]._ene.Total();
+	if (_best < 0 || total < _points[_best]._ene.Total()) {
+		_best = p;
+	}
+
+	// dominated by the frontier point before it, or by an earlier
+	// point with the same energy and time
+	std::pair<double, double> key(total, _points[p]._ene._time);
+	_on_front.push_back(false);
+	auto it = _front.lower_bound(key);
+	if ((it != _front.end() && it->first == key) ||
+		(it != _front.begin() && std::prev(it)->first.second <= key.second)) {
+		return;
+	}
+
+	// drop the points it dominates, which follow it
+	while (it != _front.end() && it->first.second >= key.second) {
+		_on_front[it->second] = false;
+		it = _front.erase(it);
+	}
+	_front.insert(it, std::make_pair(key, p));
+	_on_front[p] = true;
+}
+
+bool AdaptiveSweep::_evalCell(Cell &cell, std::vector<int> &corner_points)
+{
+	int dim_num = _dims.size();
+	int step = 1 << (_max_level - cell._level);
+
+	corner_points.clear();
+	cell._score = -1;
+	for (int c = 0; c < (1 << dim_num); c++) {
+		std::vector<int> u = cell._corner;
+		for (int d = 0; d < dim_num; d++) {
+			u[d] += ((c >> d) & 1) ? step : 0;
+		}
+		int p = _evalLattice(u);
+		if (p < 0) {
+			return false;
+		}
+		corner_points.push_back(p);
+		double total = _points[p]._ene.Total();
+		if (cell._score < 0 || total < cell._score) {
+			cell._score = total;
+		}
+	}
+	return true;
+}
+
+void AdaptiveSweep::Run(DesignEval eval)
+{
+	PROF_SCOPE("AdaptiveSweep");
+	_eval = eval;
+	_points.clear();
+	_index.clear();
+	_best = -1;
+	_front.clear();
+	_on_front.clear();
+	_finest_level = _coarse_level;
+
+	int dim_num = _dims.size();
+	int step = 1 << (_max_level - _coarse_level);
+
+	// best cell first
+	auto cmp = [](const Cell &a, const Cell &b) { return a._score > b._score; };
+	std::priority_queue<Cell, std::vector<Cell>, decltype(cmp)> queue(cmp);
+
+	// coarse grid
+	int cell_num = 1;
+	for (int d = 0; d < dim_num; d++) {
+		cell_num <<= _coarse_level;
+	}
+	std::vector<int> corner_points;
+	for (int n = 0; n < cell_num; n++) {
+		Cell cell;
+		cell._level = _coarse_level;
+		cell._corner.resize(dim_num);
+		int idx = n;
+		for (int d = 0; d < dim_num; d++) {
+			cell._corner[d] = (idx % (1 << _coarse_level)) * step;
+			idx >>= _coarse_level;
+		}
+		if (!_evalCell(cell, corner_points)) {
+			return;
+		}
+		queue.push(cell);
+	}
+
+	while (!queue.empty()) {
+		Cell cell = queue.top();
+		queue.pop();
+		if (cell._level >= _max_level) {
+			continue;
+		}
+
+		// only refine cells near the minimum or on the frontier
+		_evalCell(cell, corner_points);
+		bool promising = cell._score <= _points[_best]._ene.Total() * (1 + _tol);
+		for (int c = 0; !promising && c < corner_points.size(); c++) {
+			promising = _on_front[corner_points[c]];
+		}
+		if (!promising) {
+			continue;
+		}
+
+		// split the cell in half along every dimension
+		int half = 1 << (_max_level - cell._level - 1);
+		for (int c = 0; c < (1 << dim_num); c++) {
+			Cell child;
+			child._level = cell._level + 1;
+			child._corner = cell._corner;
+			for (int d = 0; d < dim_num; d++) {
+				child._corner[d] += ((c >> d) & 1) ? half : 0;
+			}
+			if (!_evalCell(child, corner_points)) {
+				return;
+			}
+			_finest_level = std::max(_finest_level, child._level);
+
+			// a cell whose corners are adjacent configurations in every
+			// dimension holds no other configuration, splitting it would
+			// only revisit its corners
+			const std::vector<int> &lo = _points[corner_points[0]]._config;
+			const std::vector<int> &hi = _points[corner_points.back()]._config;
+			bool inner = false;
+			for (int d = 0; !inner && d < dim_num; d++) {
+				inner = hi[d] - lo[d] > 1;
+			}
+			if (inner) {
+				queue.push(child);
+			}
+		}
+	}
+}
+
+int AdaptiveSweep::Best()
+{
+	return _best;
+}
+
+std::vector<int> AdaptiveSweep::ParetoFront()
+{
+	std::vector<int> front;
+	for (auto &f : _front) {
+		front.push_back(f.second);
+	}
+	return front;
+}
+
+double AdaptiveSweep::FullGridSize()
+{
+	// configurations a dimension can take at the finest level
+	double size = 1;
+	int n = 1 << _finest_level;
+	for (int d = 0; d < _dims.size(); d++) {
+		std::set<int> values;
+		for (int k = 0; k <= n; k++) {
+			values.insert(_dims[d].Realize((double)k / n));
+		}
+		size *= values.size();
+	}
+	return size;
+}
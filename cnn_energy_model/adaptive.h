@@ -0,0 +1,89 @@
+#pragma once
+#include "model.h"
+#include <vector>
+#include <map>
+#include <string>
+#include <functional>
+
+// one dimension of the design space. A position t in [0, 1] maps to
+// _min + t * (_max - _min), or 2 to that power for _pow2 dimensions,
+// rounded to an integer configuration value.
+class DesignDim {
+public:
+	std::string _name;
+	double _min;
+	double _max;
+	bool _pow2;
+
+public:
+	int Realize(double t);
+};
+
+class DesignPoint {
+public:
+	std::vector<int> _config;
+	EnergyModel _ene;
+};
+
+// evaluate one configuration, values in the order of the dimensions
+typedef std::function<EnergyModel(const int *config)> DesignEval;
+
+// Coarse-to-fine design space search. The space is first sampled on
+// a coarse grid. Cells of the grid are then split in half along every
+// dimension, best first, as long as they hold a point close to the
+// minimum energy or on the energy / time Pareto frontier, until the
+// evaluation budget is used up.
+class AdaptiveSweep {
+public:
+	std::vector<DesignDim> _dims;
+	int _coarse_level;	// 2^level + 1 coarse points per dimension,
+						// by default the coarse grid takes 1/8 of the budget
+	int _budget;		// maximum evaluations
+	double _tol;		// refine cells within (1 + tol) of the best energy
+
+	// every evaluated configuration
+	std::vector<DesignPoint> _points;
+
+public:
+	AdaptiveSweep(const std::vector<DesignDim> &dims, int budget);
+
+	void Run(DesignEval eval);
+
+	// index of the point with the minimum energy, -1 if there is none
+	int Best();
+
+	// indices of the points on the energy / time Pareto frontier,
+	// by energy
+	std::vector<int> ParetoFront();
+
+	// size of the full grid at the finest resolution visited
+	double FullGridSize();
+
+private:
+	// cell of the lattice at a level, corner in finest lattice units
+	class Cell {
+	public:
+		int _level;
+		std::vector<int> _corner;
+		double _score;
+	};
+
+	int _max_level;
+	int _finest_level;
+	DesignEval _eval;
+	std::map<std::vector<int>, int> _index;	// configuration to point
+
+	// kept as points are added, the frontier by (energy, time)
+	// with the time falling along it
+	int _best;
+	std::map<std::pair<double, double>, int> _front;
+	std::vector<bool> _on_front;
+
+	void _addPoint(int p);
+
+	// evaluate a lattice point, -1 if the budget is used up
+	int _evalLattice(const std::vector<int> &u);
+
+	// evaluate the corners of a cell, false if the budget is used up
+	bool _evalCell(Cell &cell, std::vector<int> &corner_points);
+};
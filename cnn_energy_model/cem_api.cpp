@@ -0,0 +1,224 @@
+#include "cem_api.h"
+#include "optimizer.h"
+#include <fstream>
+#include <sstream>
+#include <mutex>
+#include <shared_mutex>
+
+struct cem_net {
+	Optimizer _opt;
+
+	// optimizations share the network, cem_prepare changes
+	// the precomputed tables
+	std::shared_timed_mutex _mutex;
+};
+
+static void ReadBuffer(const double *f, BufferModel &buf)
+{
+	buf._size = (int)f[0];
+	buf._unit_rd_ene = f[1];
+	buf._unit_wr_ene = f[2];
+	buf._bg_pwr = f[3];
+	buf._rd_bw = f[4];
+	buf._wr_bw = f[5];
+}
+
+static void ReadAccelerator(const double *f, Accelerator &acc)
+{
+	ReadBuffer(f + CEM_IOBUF_SIZE, acc._iobuf);
+	ReadBuffer(f + CEM_WEIGHT_SIZE, acc._weight);
+	ReadBuffer(f + CEM_PINNED_SIZE, acc._pinned);
+	ReadBuffer(f + CEM_DDR_SIZE, acc._ddr);
+	ReadBuffer(f + CEM_FIFO_SIZE, acc._acc_buf);
+	acc._ddr_row._row_size = f[CEM_DDR_ROW_SIZE];
+	acc._ddr_row._act_ene = f[CEM_DDR_ACT_ENE];
+	acc._ddr_row._active_pwr = f[CEM_DDR_ACTIVE_PWR];
+	acc._use_pinned = f[CEM_USE_PINNED] != 0;
+	acc._pixel_p = (int)f[CEM_PIXEL_P];
+	acc._input_map_p = (int)f[CEM_INPUT_MAP_P];
+	acc._output_map_p = (int)f[CEM_OUTPUT_MAP_P];
+	acc._mac_ene = f[CEM_MAC_ENE];
+	acc._mac_freq = f[CEM_MAC_FREQ];
+}
+
+static bool ValidBuffer(const BufferModel &buf)
+{
+	return buf._size > 0 && buf._rd_bw > 0 && buf._wr_bw > 0;
+}
+
+// the model divides by buffer sizes, bandwidths and the frequency
+static bool ValidAccelerator(const Accelerator &acc)
+{
+	return acc._pixel_p > 0 && acc._input_map_p > 0 && acc._output_map_p > 0 &&
+		ValidBuffer(acc._iobuf) && ValidBuffer(acc._weight) &&
+		(!acc._use_pinned || ValidBuffer(acc._pinned)) &&
+		acc._ddr._rd_bw > 0 && acc._ddr._wr_bw > 0 &&
+		acc._acc_buf._size > 0 && acc._mac_ene > 0 && acc._mac_freq > 0;
+}
+
+static void WriteResult(EnergyModel &ene, double *r)
+{
+	r[CEM_RD_IOBUF] = ene._rd_iobuf;
+	r[CEM_RD_WEIGHT] = ene._rd_weight;
+	r[CEM_RD_DDR] = ene._rd_ddr;
+	r[CEM_WR_IOBUF] = ene._wr_iobuf;
+	r[CEM_WR_WEIGHT] = ene._wr_weight;
+	r[CEM_WR_DDR] = ene._wr_ddr;
+	r[CEM_BG] = ene._bg;
+	r[CEM_CALC] = ene._calc;
+	r[CEM_TOTAL] = ene.Total();
+	r[CEM_TIME] = ene._time;
+	r[CEM_DDR_TIME] = ene._ddr_time;
+}
+
+static cem_net *LoadNet(std::istream &is)
+{
+	cem_net *net = new cem_net;
+	net->_opt._verbose = false;
+	if (!net->_opt.LoadNet(is)) {
+		delete net;
+		return nullptr;
+	}
+	return net;
+}
+
+cem_net *cem_net_load_file(const char *fn)
+{
+	if (fn == nullptr) {
+		return nullptr;
+	}
+	try {
+		std::ifstream is(fn, std::ios::in);
+		return is ? LoadNet(is) : nullptr;
+	}
+	catch (...) {
+		return nullptr;
+	}
+}
+
+cem_net *cem_net_load_buffer(const char *buf, size_t len)
+{
+	if (buf == nullptr) {
+		return nullptr;
+	}
+	try {
+		std::istringstream is(std::string(buf, len));
+		return LoadNet(is);
+	}
+	catch (...) {
+		return nullptr;
+	}
+}
+
+void cem_net_free(cem_net *net)
+{
+	delete net;
+}
+
+int cem_net_layer_num(const cem_net *net)
+{
+	return (net == nullptr) ? CEM_ERR_ARG : (int)net->_opt._net.size();
+}
+
+int cem_prepare(cem_net *net, const double *acc, int n)
+{
+	if (net == nullptr || acc == nullptr || n < 0) {
+		return CEM_ERR_ARG;
+	}
+	try {
+		std::unique_lock<std::shared_timed_mutex> lock(net->_mutex);
+		for (int c = 0; c < n; c++) {
+			Accelerator a;
+			ReadAccelerator(acc + (size_t)c * CEM_ACC_FIELD_NUM, a);
+			if (!ValidAccelerator(a)) {
+				return CEM_ERR_ARG;
+			}
+			net->_opt.Precompute(&a);
+		}
+	}
+	catch (...) {
+		return CEM_ERR_INTERNAL;
+	}
+	return CEM_OK;
+}
+
+int cem_evaluate(cem_net *net, const double *acc, int n, double *result)
+{
+	if (net == nullptr || acc == nullptr || result == nullptr || n < 0) {
+		return CEM_ERR_ARG;
+	}
+	try {
+		std::shared_lock<std::shared_timed_mutex> lock(net->_mutex);
+		for (int c = 0; c < n; c++) {
+			Accelerator a;
+			ReadAccelerator(acc + (size_t)c * CEM_ACC_FIELD_NUM, a);
+			if (!ValidAccelerator(a)) {
+				return CEM_ERR_ARG;
+			}
+
+			EnergyModel ene;
+			ActivityFunc func = net->_opt.GetActivityFunc(&a);
+			for (int l = 0; l < net->_opt._net.size(); l++) {
+				LayerActivity act = Optimizer::GetActivity(func, &a, net->_opt._net[l]);
+				EnergyModel layer_ene = Optimizer::ActivityEnergy(&a, act);
+				layer_ene._time = act._cycle / a._mac_freq;
+				ene = ene + layer_ene;
+			}
+			WriteResult(ene, result + (size_t)c * CEM_RESULT_FIELD_NUM);
+		}
+	}
+	catch (...) {
+		return CEM_ERR_INTERNAL;
+	}
+	return CEM_OK;
+}
+
+int cem_optimize(cem_net *net, int method, const double *acc, int n,
+	double *result, unsigned long long *schedule)
+{
+	if (net == nullptr || acc == nullptr || result == nullptr || n < 0 ||
+		method < CEM_SINGLE || method > CEM_FIXED) {
+		return CEM_ERR_ARG;
+	}
+	try {
+		std::shared_lock<std::shared_timed_mutex> lock(net->_mutex);
+		Optimizer &opt = net->_opt;
+
+		// the cross layer optimization starts without pinned weights,
+		// use the pinning recursion scratch for its weight_ready
+		OptScratch *scratch = OptScratch::Get();
+		scratch->ReservePin(opt._net.size());
+
+		for (int c = 0; c < n; c++) {
+			Accelerator a;
+			ReadAccelerator(acc + (size_t)c * CEM_ACC_FIELD_NUM, a);
+			if (!ValidAccelerator(a)) {
+				return CEM_ERR_ARG;
+			}
+
+			EnergyModel ene;
+			if (method == CEM_SINGLE) {
+				ene = opt.OptNetworkSingle(&a);
+			}
+			else if (method == CEM_CROSS) {
+				bool *weight_ready = scratch->_weight_ready;
+				for (int l = 0; l < opt._net.size(); l++) {
+					weight_ready[l] = false;
+				}
+				ene = opt.OptNetworkCrossLayer(&a, weight_ready);
+			}
+			else {
+				ene = opt.OptNetworkFixedWeights(&a);
+			}
+
+			WriteResult(ene, result + (size_t)c * CEM_RESULT_FIELD_NUM);
+			if (schedule != nullptr) {
+				schedule[c] = ene._schedule;
+			}
+		}
+	}
+	catch (...) {
+		return CEM_ERR_INTERNAL;
+	}
+	return CEM_OK;
+}
@@ -0,0 +1,113 @@
+#ifndef CEM_API_H
+#define CEM_API_H
+
+/* C interface of the CNN energy model, for calling the model in-process.
+ *
+ * A network is loaded once and can then be shared by any number of threads.
+ * Accelerators are passed as flat arrays of CEM_ACC_FIELD_NUM doubles per
+ * configuration, indexed by cem_acc_field, and results are written to
+ * caller provided arrays of CEM_RESULT_FIELD_NUM doubles per configuration.
+ * The batch calls do not allocate once each calling thread has run one
+ * optimization on a network of the same size.
+ *
+ * Functions returning int give CEM_OK or a negative cem_error.
+ *
+ * The library is the "cem" target of CMakeLists.txt: every source but
+ * main.cpp, built with CEM_BUILD_DLL and NO_PROFILER defined and hidden
+ * visibility, so only these functions are exported. */
+
+#include <stddef.h>
+
+#if defined(_WIN32) && defined(CEM_BUILD_DLL)
+#define CEM_API __declspec(dllexport)
+#elif defined(_WIN32) && defined(CEM_USE_DLL)
+#define CEM_API __declspec(dllimport)
+#elif defined(__GNUC__)
+#define CEM_API __attribute__((visibility("default")))
+#else
+#define CEM_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CEM_API_VERSION 1
+
+typedef struct cem_net cem_net;
+
+enum cem_error {
+	CEM_OK = 0,
+	CEM_ERR_ARG = -1,		/* null pointer or bad count, method or field */
+	CEM_ERR_INTERNAL = -2,	/* the model failed, e.g. out of memory */
+};
+
+enum cem_method {
+	CEM_SINGLE = 0,			/* every layer optimized independently */
+	CEM_CROSS = 1,			/* cross layer merging, no pinned weights */
+	CEM_FIXED = 2,			/* cross layer merging with pinned weights */
+};
+
+/* one accelerator; buffer sizes in datum, energies in pJ per datum,
+ * power in mW, bandwidths in mega datum per second, frequency in MHz */
+enum cem_acc_field {
+	CEM_IOBUF_SIZE, CEM_IOBUF_RD_ENE, CEM_IOBUF_WR_ENE, CEM_IOBUF_BG_PWR,
+	CEM_IOBUF_RD_BW, CEM_IOBUF_WR_BW,
+	CEM_WEIGHT_SIZE, CEM_WEIGHT_RD_ENE, CEM_WEIGHT_WR_ENE, CEM_WEIGHT_BG_PWR,
+	CEM_WEIGHT_RD_BW, CEM_WEIGHT_WR_BW,
+	CEM_PINNED_SIZE, CEM_PINNED_RD_ENE, CEM_PINNED_WR_ENE, CEM_PINNED_BG_PWR,
+	CEM_PINNED_RD_BW, CEM_PINNED_WR_BW,
+	CEM_DDR_SIZE, CEM_DDR_RD_ENE, CEM_DDR_WR_ENE, CEM_DDR_BG_PWR,
+	CEM_DDR_RD_BW, CEM_DDR_WR_BW,
+	CEM_FIFO_SIZE, CEM_FIFO_RD_ENE, CEM_FIFO_WR_ENE, CEM_FIFO_BG_PWR,
+	CEM_FIFO_RD_BW, CEM_FIFO_WR_BW,
+	CEM_DDR_ROW_SIZE,		/* 0 for the flat DDR model */
+	CEM_DDR_ACT_ENE,
+	CEM_DDR_ACTIVE_PWR,
+	CEM_USE_PINNED,			/* nonzero if the pinned tier exists */
+	CEM_PIXEL_P,
+	CEM_INPUT_MAP_P,
+	CEM_OUTPUT_MAP_P,
+	CEM_MAC_ENE,
+	CEM_MAC_FREQ,
+	CEM_ACC_FIELD_NUM
+};
+
+/* result of one configuration, energies in pJ and times in us */
+enum cem_result_field {
+	CEM_RD_IOBUF, CEM_RD_WEIGHT, CEM_RD_DDR,
+	CEM_WR_IOBUF, CEM_WR_WEIGHT, CEM_WR_DDR,
+	CEM_BG, CEM_CALC, CEM_TOTAL,
+	CEM_TIME, CEM_DDR_TIME,
+	CEM_RESULT_FIELD_NUM
+};
+
+/* load a network from a file or from a buffer in the same format,
+ * NULL if it cannot be read */
+CEM_API cem_net *cem_net_load_file(const char *fn);
+CEM_API cem_net *cem_net_load_buffer(const char *buf, size_t len);
+
+/* free a network, no call on it may be running */
+CEM_API void cem_net_free(cem_net *net);
+
+CEM_API int cem_net_layer_num(const cem_net *net);
+
+/* precompute the layer activity for the MAC array shapes of n
+ * accelerators, later calls with these shapes reuse it. This waits
+ * for running calls on the network to finish. */
+CEM_API int cem_prepare(cem_net *net, const double *acc, int n);
+
+/* schedule independent on-chip energy and calculation time of n
+ * accelerators, the DDR and background fields are 0 */
+CEM_API int cem_evaluate(cem_net *net, const double *acc, int n, double *result);
+
+/* optimize the schedule on n accelerators with a cem_method, schedule
+ * receives the schedule id of each configuration and may be NULL */
+CEM_API int cem_optimize(cem_net *net, int method, const double *acc, int n,
+	double *result, unsigned long long *schedule);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
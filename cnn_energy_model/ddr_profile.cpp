@@ -0,0 +1,120 @@
+#include "ddr_profile.h"
+#include "device_param.h"
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <iomanip>
+
+DDRProfile::DDRProfile()
+{
+	_name = "default";
+	_channel_num = 1;
+	_chip_num = DDR_CHIP_NUM;
+	_chip_bw = DDR_CHIP_BW;
+	_freq_mhz = DDR_FREQ_MHZ;
+	_bw_eff = 1.0;
+
+	_bg_pwr = DDR_BG_PWR_PER_CHIP_MW;
+	_rd_pwr_ratio = DDR_RD_PWR_RATIO;
+	_wr_pwr_ratio = DDR_WR_PWR_RATIO;
+	_act_pwr_ratio = DDR_ACT_PWR_RATIO;
+	_active_pwr_ratio = 0.0;
+	_row_size = 0.0;
+}
+
+bool DDRProfile::LoadFromFile(const std::string fn)
+{
+	std::ifstream is(fn, std::ios::in);
+	if (!is) {
+		std::cout << "cannot open DDR profile " << fn << std::endl;
+		return false;
+	}
+
+	std::string line;
+	while (std::getline(is, line)) {
+		line = line.substr(0, line.find('#'));
+		std::istringstream ls(line);
+		std::string key;
+		if (!(ls >> key)) {
+			continue;
+		}
+
+		if (key == "name") ls >> _name;
+		else if (key == "channel_num") ls >> _channel_num;
+		else if (key == "chip_num") ls >> _chip_num;
+		else if (key == "chip_bw") ls >> _chip_bw;
+		else if (key == "freq_mhz") ls >> _freq_mhz;
+		else if (key == "bw_eff") ls >> _bw_eff;
+		else if (key == "bg_pwr") ls >> _bg_pwr;
+		else if (key == "rd_pwr_ratio") ls >> _rd_pwr_ratio;
+		else if (key == "wr_pwr_ratio") ls >> _wr_pwr_ratio;
+		else if (key == "act_pwr_ratio") ls >> _act_pwr_ratio;
+		else if (key == "active_pwr_ratio") ls >> _active_pwr_ratio;
+		else if (key == "row_size") ls >> _row_size;
+		else {
+			std::cout << "unknown key in DDR profile " << fn << ": " << key << std::endl;
+			return false;
+		}
+		if (!ls) {
+			std::cout << "bad value in DDR profile " << fn << ": " << key << std::endl;
+			return false;
+		}
+	}
+
+	// the bandwidth and the energy per byte divide by these
+	if (_channel_num <= 0 || _chip_num <= 0 || !(_chip_bw > 0) ||
+		!(_freq_mhz > 0) || !(_bw_eff > 0)) {
+		std::cout << "DDR profile " << fn << " needs positive channel_num, chip_num, " <<
+			"chip_bw, freq_mhz and bw_eff" << std::endl;
+		return false;
+	}
+	if (!(_bg_pwr >= 0) || !(_rd_pwr_ratio >= 0) || !(_wr_pwr_ratio >= 0) ||
+		!(_act_pwr_ratio >= 0) || !(_active_pwr_ratio >= 0) || !(_row_size >= 0)) {
+		std::cout << "DDR profile " << fn << " has a negative power or row size" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+double DDRProfile::ChipBw()
+{
+	return _freq_mhz * 2 * _chip_bw / 8;
+}
+
+double DDRProfile::Bandwidth()
+{
+	return ChipBw() * _chip_num * _channel_num * _bw_eff;
+}
+
+void DDRProfile::Apply(Accelerator *acc)
+{
+	// chips work in lock step and channels are interleaved, so every
+	// chip sees the same usage and the energy per byte is per chip
+	double act_ene_per_byte = _act_pwr_ratio / (ChipBw() * 0.01) * 1000;
+
+	acc->_ddr._rd_bw = Bandwidth();
+	acc->_ddr._wr_bw = Bandwidth();
+	acc->_ddr._unit_rd_ene = act_ene_per_byte +
+		_rd_pwr_ratio / (ChipBw() * 0.01) * 1000;
+	acc->_ddr._unit_wr_ene = act_ene_per_byte +
+		_wr_pwr_ratio / (ChipBw() * 0.01) * 1000;
+	acc->_ddr._bg_pwr = _bg_pwr * _chip_num * _channel_num;
+
+	// a row spans all the chips of a channel, and the calculator
+	// activation power corresponds to one activation per row
+	acc->_ddr_row._row_size = _row_size * _chip_num;
+	acc->_ddr_row._act_ene = act_ene_per_byte * acc->_ddr_row._row_size;
+	acc->_ddr_row._active_pwr = _active_pwr_ratio * 100 * _chip_num * _channel_num;
+	return;
+}
+
+std::string DDRProfile::Describe()
+{
+	std::ostringstream os;
+	os << std::setprecision(17) << "channel_num:" << _channel_num << ",chip_num:" << _chip_num <<
+		",chip_bw:" << _chip_bw << ",freq_mhz:" << _freq_mhz << ",bw_eff:" << _bw_eff <<
+		",bg_pwr:" << _bg_pwr << ",rd_pwr_ratio:" << _rd_pwr_ratio <<
+		",wr_pwr_ratio:" << _wr_pwr_ratio << ",act_pwr_ratio:" << _act_pwr_ratio <<
+		",active_pwr_ratio:" << _active_pwr_ratio << ",row_size:" << _row_size;
+	return os.str();
+}
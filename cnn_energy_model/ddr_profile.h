@@ -0,0 +1,45 @@
+#pragma once
+#include "model.h"
+#include <string>
+
+// DDR memory system loaded from a profile file. The power numbers
+// are per chip, in the form given by the DDR power calculator,
+// i.e. mW per 1% bandwidth usage of the chip.
+class DDRProfile {
+public:
+	std::string _name;
+
+	int    _channel_num;	// independent channels
+	int    _chip_num;		// chips per channel
+	double _chip_bw;		// chip bit width
+	double _freq_mhz;		// working frequency, both pos and neg edge
+	double _bw_eff;			// sustained / peak bandwidth
+
+	double _bg_pwr;			// background power (mW)
+	double _rd_pwr_ratio;	// power(mW) / (1% bandwidth usage)
+	double _wr_pwr_ratio;	// power(mW) / (1% bandwidth usage)
+	double _act_pwr_ratio;	// power(mW) / (1% bandwidth usage), sequential access
+	double _active_pwr_ratio;	// extra standby power(mW) / (1% bandwidth usage)
+	double _row_size;		// bytes per row, 0 to disable the row buffer model
+
+public:
+	// the default profile is the DDR device in device_param.h
+	DDRProfile();
+
+	// load a profile of "key value" lines, '#' starts a comment
+	// returns false if the file can not be read, has an unknown key
+	// or a value the model can not use
+	bool LoadFromFile(const std::string fn);
+
+	// peak bandwidth of one chip (MB/s)
+	double ChipBw();
+
+	// sustained bandwidth of the memory system (MB/s)
+	double Bandwidth();
+
+	// set the DDR model of an accelerator
+	void Apply(Accelerator *acc);
+
+	// the values of the profile on one line, without the name
+	std::string Describe();
+};
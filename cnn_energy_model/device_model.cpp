@@ -0,0 +1,44 @@
+#include "device_model.h"
+#include "device_param.h"
+#include <cmath>
+
+static double LogInterp(const int *size, const double *val, int n, double x)
+{
+	if (x <= size[0]) {
+		return val[0];
+	}
+	if (x >= size[n - 1]) {
+		return val[n - 1];
+	}
+	int i = 0;
+	while (x > size[i + 1]) {
+		i++;
+	}
+	double t = (std::log2(x) - std::log2((double)size[i])) /
+		(std::log2((double)size[i + 1]) - std::log2((double)size[i]));
+	return val[i] + (val[i + 1] - val[i]) * t;
+}
+
+BufferModel InterpolateSRAM(double size)
+{
+	BufferModel buf;
+	buf._size = (int)size;
+	buf._rd_bw = LogInterp(SRAM_UNIT_SIZE, SRAM_UNIT_RD_BW, 5, size);
+	buf._wr_bw = LogInterp(SRAM_UNIT_SIZE, SRAM_UNIT_WR_BW, 5, size);
+	buf._unit_rd_ene = LogInterp(SRAM_UNIT_SIZE, SRAM_UNIT_RD_ENE, 5, size);
+	buf._unit_wr_ene = LogInterp(SRAM_UNIT_SIZE, SRAM_UNIT_WR_ENE, 5, size);
+	buf._bg_pwr = LogInterp(SRAM_UNIT_SIZE, SRAM_UNIT_BG_PWR, 5, size);
+	return buf;
+}
+
+BufferModel InterpolateRRAM(double size)
+{
+	BufferModel buf;
+	buf._size = (int)size;
+	buf._rd_bw = LogInterp(RRAM_UNIT_SIZE, RRAM_UNIT_RD_BW, 5, size);
+	buf._wr_bw = LogInterp(RRAM_UNIT_SIZE, RRAM_UNIT_WR_BW, 5, size);
+	buf._unit_rd_ene = LogInterp(RRAM_UNIT_SIZE, RRAM_UNIT_RD_ENE, 5, size);
+	buf._unit_wr_ene = LogInterp(RRAM_UNIT_SIZE, RRAM_UNIT_WR_ENE, 5, size);
+	buf._bg_pwr = LogInterp(RRAM_UNIT_SIZE, RRAM_UNIT_BG_PWR, 5, size);
+	return buf;
+}
@@ -0,0 +1,10 @@
+#pragma once
+#include "model.h"
+
+// Device parameters of a single memory unit between the sizes in
+// device_param.h. Every parameter is interpolated linearly in
+// log2(size) and clamped at both ends of the table.
+
+BufferModel InterpolateSRAM(double size);
+
+BufferModel InterpolateRRAM(double size);
@@ -0,0 +1,316 @@
+#include "incremental.h"
+#include "profiler.h"
+#include <fstream>
+#include <cstring>
+
+static const char INC_MAGIC[4] = { 'C', 'E', 'M', 'I' };
+static const int INC_VERSION = 3;
+
+static unsigned long long Mix(unsigned long long h, unsigned long long v)
+{
+	// splitmix64 finalizer of v, combined as EnergyModel::AddDecision does
+	v += 0x9e3779b97f4a7c15ULL;
+	v = (v ^ (v >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	v = (v ^ (v >> 27)) * 0x94d049bb133111ebULL;
+	v ^= v >> 31;
+	return h ^ (v + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2));
+}
+
+static unsigned long long MixDouble(unsigned long long h, double v)
+{
+	unsigned long long bits;
+	memcpy(&bits, &v, 8);
+	return Mix(h, bits);
+}
+
+static unsigned long long MixBuffer(unsigned long long h, BufferModel &buf)
+{
+	h = Mix(h, buf._size);
+	h = MixDouble(h, buf._unit_rd_ene);
+	h = MixDouble(h, buf._unit_wr_ene);
+	h = MixDouble(h, buf._bg_pwr);
+	h = MixDouble(h, buf._rd_bw);
+	return MixDouble(h, buf._wr_bw);
+}
+
+unsigned long long IncrementalCache::HashAccelerator(Accelerator *acc)
+{
+	unsigned long long h = 0;
+	h = MixBuffer(h, acc->_iobuf);
+	h = MixBuffer(h, acc->_weight);
+	h = MixBuffer(h, acc->_ddr);
+	// the DP never reads the size of the pin buffer, so the
+	// pinnings tried on one accelerator share their entries
+	BufferModel pinned = acc->_pinned;
+	pinned._size = 0;
+	h = MixBuffer(h, pinned);
+	h = MixBuffer(h, acc->_acc_buf);
+	h = MixDouble(h, acc->_ddr_row._row_size);
+	h = MixDouble(h, acc->_ddr_row._act_ene);
+	h = MixDouble(h, acc->_ddr_row._active_pwr);
+	h = Mix(h, acc->_use_pinned);
+	h = Mix(h, acc->_input_map_p);
+	h = Mix(h, acc->_output_map_p);
+	h = Mix(h, acc->_pixel_p);
+	h = MixDouble(h, acc->_mac_ene);
+	return MixDouble(h, acc->_mac_freq);
+}
+
+unsigned long long IncrementalCache::HashLayer(Layer *l)
+{
+	int fields[] = {
+		l->_type, l->_input_map_x, l->_input_map_y, l->_kernel_x, l->_kernel_y,
+		l->_kernel_str, l->_pad_x, l->_pad_y, l->_input_map_num, l->_output_map_num,
+		l->_is_pooling, l->_pool_x, l->_pool_y, l->_pool_str, l->_pool_pad_x, l->_pool_pad_y,
+		l->_group,
+	};
+	unsigned long long h = 0;
+	for (int f = 0; f < sizeof(fields) / sizeof(int); f++) {
+		// pooling parameters only count for pooling layers
+		if (!l->_is_pooling && f >= 11 && f <= 15) {
+			continue;
+		}
+		h = Mix(h, (unsigned int)fields[f]);
+	}
+	return h;
+}
+
+IncrementalCache::IncrementalCache()
+{
+	_reuse_num = 0;
+	_same_num = 0;
+	_max_size = 64 << 20;
+	_prefix_hit = 0;
+	_prefix_miss = 0;
+	_saved = false;
+	_saved_num = 0;
+}
+
+// The file is the layer list followed by blocks of entries, one per
+// save. A block cut short by an interrupted save is dropped.
+bool IncrementalCache::Load(const std::string fn)
+{
+	std::ifstream is(fn, std::ios::in | std::ios::binary | std::ios::ate);
+	long long file_size = is.tellg();
+	is.seekg(0);
+	char magic[4];
+	int version = 0;
+	int entry_size = 0;
+	if (!is.read(magic, 4) || memcmp(magic, INC_MAGIC, 4) != 0 ||
+		!is.read((char *)&version, 4) || version != INC_VERSION ||
+		!is.read((char *)&entry_size, 4) || entry_size != sizeof(PrefixEntry)) {
+		return false;
+	}
+
+	int layer_num = 0;
+	is.read((char *)&layer_num, 4);
+	if (!is || layer_num <= 0 || 8LL * layer_num > file_size) {
+		return false;
+	}
+	_old_layers.resize(layer_num);
+	if (!is.read((char *)_old_layers.data(), 8 * layer_num)) {
+		_old_layers.clear();
+		return false;
+	}
+
+	// the pages of the reserved entries are only taken once written,
+	// growing the entries would copy them
+	_entries.clear();
+	_entries.reserve(_max_size / sizeof(PrefixEntry));
+	long long count;
+	while (is.read((char *)&count, 8)) {
+		long long left = file_size - is.tellg();
+		if (count < 0 || count * (long long)sizeof(PrefixEntry) > left) {
+			break;
+		}
+		size_t off = _entries.size();
+		_entries.resize(off + count);
+		if (!is.read((char *)&_entries[off], count * sizeof(PrefixEntry))) {
+			// a damaged cache is only a slower run
+			_old_layers.clear();
+			_entries.clear();
+			return false;
+		}
+	}
+	return true;
+}
+
+bool IncrementalCache::Save(const std::string fn)
+{
+	PROF_SCOPE("incremental save");
+	std::lock_guard<std::mutex> lock(_mutex);
+	int layer_num = _new_layers.size();
+
+	std::ofstream os;
+	if (!_saved) {
+		int entry_size = sizeof(PrefixEntry);
+		os.open(fn, std::ios::out | std::ios::binary | std::ios::trunc);
+		os.write(INC_MAGIC, 4);
+		os.write((const char *)&INC_VERSION, 4);
+		os.write((const char *)&entry_size, 4);
+		os.write((const char *)&layer_num, 4);
+		os.write((const char *)_new_layers.data(), 8 * layer_num);
+	}
+	else {
+		os.open(fn, std::ios::out | std::ios::binary | std::ios::app);
+	}
+
+	long long count = _entries.size() - _saved_num;
+	os.write((const char *)&count, 8);
+	os.write((const char *)(_entries.data() + _saved_num), count * sizeof(PrefixEntry));
+	os.close();
+	if (!os) {
+		return false;
+	}
+	_saved = true;
+	_saved_num = _entries.size();
+	return true;
+}
+
+void IncrementalCache::Diff(Net &net)
+{
+	int layer_num = net.size();
+	_new_layers.resize(layer_num);
+	for (int i = 0; i < layer_num; i++) {
+		_new_layers[i] = HashLayer(net[i]);
+	}
+
+	int old_num = _old_layers.size();
+	int same = 0;
+	while (same < layer_num && same < old_num && _new_layers[same] == _old_layers[same]) {
+		same++;
+	}
+	_same_num = same;
+
+	// entry i also depends on whether layer i + 1 exists and fits
+	// the buffer, and the last layer of either net is never reused
+	_reuse_num = same - 1;
+	_reuse_num = MIN(_reuse_num, layer_num - 1);
+	_reuse_num = MIN(_reuse_num, old_num - 1);
+	if (_reuse_num < 0) {
+		_reuse_num = 0;
+	}
+
+	// the entries still valid are kept for the next run as well,
+	// a prefix comes before its extensions
+	std::vector<int> depth(_entries.size()), moved(_entries.size(), -1);
+	int num = 0;
+	for (int n = 0; n < _entries.size(); n++) {
+		PrefixEntry e = _entries[n];
+		if (e._parent >= n || (e._parent >= 0 && moved[e._parent] < 0)) {
+			continue;
+		}
+		depth[n] = (e._parent >= 0) ? depth[e._parent] + 1 : 0;
+		if (depth[n] >= _reuse_num || e._cut < 0 || e._cut > depth[n] ||
+			(num + 1) * sizeof(PrefixEntry) > _max_size) {
+			continue;
+		}
+		e._ready = e._ready != 0;
+		e._input_ready = e._input_ready != 0;
+		e._parent = (e._parent >= 0) ? moved[e._parent] : -1;
+		moved[n] = num;
+		_entries[num++] = e;
+	}
+	_entries.resize(num);
+	_entries.reserve(_max_size / sizeof(PrefixEntry));
+
+	_roots.clear();
+	for (int n = 0; n < num; n++) {
+		_entries[n]._child[0] = -1;
+		_entries[n]._child[1] = -1;
+	}
+	for (int n = 0; n < num; n++) {
+		_link(n);
+	}
+	_saved = false;
+	_saved_num = 0;
+}
+
+bool IncrementalCache::Changed()
+{
+	return !_old_layers.empty() && _old_layers != _new_layers;
+}
+
+void IncrementalCache::_link(int n)
+{
+	PrefixEntry &e = _entries[n];
+	if (e._parent < 0) {
+		_roots.insert(std::make_pair(_rootKey(e._acc_hash, e._ready), n));
+	}
+	else if (_entries[e._parent]._child[e._ready] < 0) {
+		_entries[e._parent]._child[e._ready] = n;
+	}
+}
+
+unsigned long long IncrementalCache::_rootKey(unsigned long long acc_hash, bool ready)
+{
+	return Mix(acc_hash, ready ? 1 : 0);
+}
+
+int IncrementalCache::_walk(unsigned long long acc_hash, const bool *weight_ready, int num)
+{
+	auto it = _roots.find(_rootKey(acc_hash, weight_ready[0]));
+	int n = (it != _roots.end()) ? it->second : -1;
+	for (int i = 1; i < num && n >= 0; i++) {
+		n = _entries[n]._child[weight_ready[i]];
+	}
+	return n;
+}
+
+int IncrementalCache::FindPrefix(unsigned long long acc_hash, const bool *weight_ready,
+	EnergyModel *opt_ene, int *cut, bool *input_ready)
+{
+	int layer_num = _new_layers.size();
+	std::lock_guard<std::mutex> lock(_mutex);
+	int num = 0;
+	for (int n = _walk(acc_hash, weight_ready, 1); n >= 0; ) {
+		const PrefixEntry &e = _entries[n];
+		opt_ene[num] = e._opt_ene;
+		cut[num] = e._cut;
+		input_ready[num + 1] = e._input_ready;
+		num++;
+		n = (num < layer_num) ? e._child[weight_ready[num]] : -1;
+	}
+	if (num == 0) {
+		_prefix_miss++;
+		return 0;
+	}
+	input_ready[0] = false;
+	_prefix_hit++;
+	return num;
+}
+
+void IncrementalCache::StoreState(unsigned long long acc_hash, const bool *weight_ready,
+	int start, const EnergyModel *opt_ene, const int *cut, const bool *input_ready)
+{
+	int layer_num = _new_layers.size();
+	std::lock_guard<std::mutex> lock(_mutex);
+	int parent = (start > 0) ? _walk(acc_hash, weight_ready, start) : -1;
+	if (start > 0 && parent < 0) {
+		return;
+	}
+	for (int i = start; i < layer_num; i++) {
+		if ((_entries.size() + 1) * sizeof(PrefixEntry) > _max_size) {
+			return;
+		}
+		// the padding is written to the file as well
+		PrefixEntry e;
+		memset((void *)&e, 0, sizeof(e));
+		e._opt_ene = opt_ene[i];
+		e._acc_hash = (i == 0) ? acc_hash : 0;
+		e._parent = parent;
+		e._cut = cut[i];
+		e._child[0] = -1;
+		e._child[1] = -1;
+		e._ready = weight_ready[i];
+		e._input_ready = input_ready[i + 1];
+		parent = _entries.size();
+		_entries.push_back(e);
+		_link(parent);
+	}
+}
+
+long long IncrementalCache::EntryNum()
+{
+	return _entries.size();
+}
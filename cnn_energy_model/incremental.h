@@ -0,0 +1,99 @@
+#pragma once
+#include "model.h"
+#include "layer.h"
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <mutex>
+
+// Results of the previous run kept for an edited network. Diff() compares
+// the layer list with the one of the previous run. DP entry i of the cross
+// layer optimization depends on layers 0 to i + 1 only, so entries before
+// the first edited layer minus one are reused and only the suffix is run
+// again. The entries of an accelerator, found by a 64 bit hash of it, form
+// a trie of the weight_ready flags, so the pinnings tried with a common
+// prefix share their entries, within a run as well. The OptSingleLayer
+// results of the suffix are not kept: a lookup costs about as much as the
+// layer once its activity is precomputed (Optimizer::Precompute).
+class IncrementalCache {
+public:
+	// entries of layers 0 to _reuse_num - 1 of the previous run are valid
+	int _reuse_num;
+	// leading layers equal to those of the previous run
+	int _same_num;
+
+	// entries are kept up to this many bytes, reserved when loaded
+	size_t _max_size;
+
+	long long _prefix_hit;
+	long long _prefix_miss;
+
+public:
+	IncrementalCache();
+
+	// results of the previous run, false if there are none
+	bool Load(const std::string fn);
+
+	// the entries of this run and the reused ones, for the next run.
+	// The first call writes the file, later ones append the entries
+	// added since.
+	bool Save(const std::string fn);
+
+	// compare net with the layer list of the previous run, only the
+	// entries still valid for net are kept
+	void Diff(Net &net);
+
+	// a previous run was loaded and its layer list differs
+	bool Changed();
+
+	// copy the longest kept DP prefix into the arrays of
+	// OptNetworkCrossLayer, returns its length
+	int FindPrefix(unsigned long long acc_hash, const bool *weight_ready,
+		EnergyModel *opt_ene, int *cut, bool *input_ready);
+
+	// keep DP entries start to the last of a run of OptNetworkCrossLayer,
+	// entries 0 to start - 1 are the prefix it was given
+	void StoreState(unsigned long long acc_hash, const bool *weight_ready, int start,
+		const EnergyModel *opt_ene, const int *cut, const bool *input_ready);
+
+	long long EntryNum();
+
+	// what the cross layer DP reads of acc
+	static unsigned long long HashAccelerator(Accelerator *acc);
+	static unsigned long long HashLayer(Layer *l);
+
+private:
+	std::mutex _mutex;
+
+	// DP entry i of a cross layer optimization, a node of the trie of
+	// the weight_ready flags tried on one accelerator
+	struct PrefixEntry {
+		EnergyModel _opt_ene;
+		unsigned long long _acc_hash;	// for layer 0, the root of the trie
+		int _parent;	// entry of layer i - 1, -1 for layer 0
+		int _cut;
+		int _child[2];	// entries of layer i + 1 by its weight_ready flag
+		unsigned char _ready;	// weight_ready of layer i
+		unsigned char _input_ready;	// input_ready of layer i + 1
+	};
+
+	std::vector<unsigned long long> _old_layers;
+	std::vector<unsigned long long> _new_layers;
+
+	// entries in the order they were added, a prefix before its
+	// extensions, and the entries of layer 0 by accelerator and flag
+	std::vector<PrefixEntry> _entries;
+	std::unordered_map<unsigned long long, int> _roots;
+
+	// what the file of this run holds
+	bool _saved;
+	size_t _saved_num;
+
+	// add entry n to the trie
+	void _link(int n);
+
+	static unsigned long long _rootKey(unsigned long long acc_hash, bool ready);
+
+	// the entry of layer num - 1 of the prefix, -1 if none
+	int _walk(unsigned long long acc_hash, const bool *weight_ready, int num);
+};
@@ -1,13 +1,29 @@
 #include "layer.h"
 #include <fstream>
 
+// output size of a window sliding over size datum
+static int SlideOutput(int size, int window, int stride, int pad)
+{
+	if (pad == PAD_SAME) {
+		return size / stride;
+	}
+	int res = (size + 2 * pad - window) / stride + 1;
+	return (res > 0) ? res : 0;
+}
+
+void Layer::GetConvOutputShape(int &output_map_x, int &output_map_y)
+{
+	output_map_x = SlideOutput(_input_map_x, _kernel_x, _kernel_str, _pad_x);
+	output_map_y = SlideOutput(_input_map_y, _kernel_y, _kernel_str, _pad_y);
+	return;
+}
+
 void Layer::GetOutputMapShape(int &output_map_x, int &output_map_y)
 {
-	output_map_x = _input_map_x / _kernel_str;
-	output_map_y = _input_map_y / _kernel_str;
+	GetConvOutputShape(output_map_x, output_map_y);
 	if (_is_pooling) {
-		output_map_x = output_map_x / _pool_str;
-		output_map_y = output_map_y / _pool_str;
+		output_map_x = SlideOutput(output_map_x, _pool_x, _pool_str, _pool_pad_x);
+		output_map_y = SlideOutput(output_map_y, _pool_y, _pool_str, _pool_pad_y);
 	}
 	return;
 }
@@ -26,14 +42,217 @@ int Layer::GetOutputMapSize()
 
 int Layer::GetWeightSize()
 {
-	return _kernel_x * _kernel_y * _input_map_num * _output_map_num;
+	if (_type == LAYER_POOL) {
+		return 0;
+	}
+	// each output map only sees the input maps of its group
+	return _kernel_x * _kernel_y * (_input_map_num / _group) * _output_map_num;
 }
 
 double Layer::GetMacNum()
 {
-	double res;
-	res = _input_map_x * _input_map_y / _kernel_str / _kernel_str;
+	if (_type == LAYER_POOL) {
+		return 0.0;
+	}
+	int output_map_x, output_map_y;
+	GetConvOutputShape(output_map_x, output_map_y);
+	double res = output_map_x * output_map_y;
 	res *= _kernel_x * _kernel_y;
-	res *= _input_map_num * _output_map_num;
+	res *= (double)(_input_map_num / _group) * _output_map_num;
 	return res;
-}
\ No newline at end of file
+}
+
+//=============================================================================
+// extended format parser, works on the characters of a line in place
+//=============================================================================
+
+static void SkipSpace(const char *&p)
+{
+	while (*p == ' ' || *p == '\t' || *p == '\r') {
+		p++;
+	}
+}
+
+// unsigned integer at p, -1 if there is none
+static int ReadInt(const char *&p)
+{
+	if (*p < '0' || *p > '9') {
+		return -1;
+	}
+	int v = 0;
+	while (*p >= '0' && *p <= '9') {
+		v = v * 10 + (*p - '0');
+		p++;
+	}
+	return v;
+}
+
+// "<a>[x<b>[x<c>]]", returns the number of parts read
+static int ReadDims(const char *&p, int *dims, int max_num)
+{
+	int num = 0;
+	while (num < max_num) {
+		dims[num] = ReadInt(p);
+		if (dims[num] < 0) {
+			return -1;
+		}
+		num++;
+		if (*p != 'x') {
+			break;
+		}
+		p++;
+	}
+	return num;
+}
+
+static bool ReadWord(const char *&p, const char *word)
+{
+	const char *q = p;
+	while (*word != '\0') {
+		if (*q++ != *word++) {
+			return false;
+		}
+	}
+	p = q;
+	return true;
+}
+
+// "<a>[x<b>]", b defaults to a
+static bool ReadPair(const char *&p, int &a, int &b)
+{
+	int dims[2];
+	int num = ReadDims(p, dims, 2);
+	if (num < 1) {
+		return false;
+	}
+	a = dims[0];
+	b = (num == 2) ? dims[1] : dims[0];
+	return true;
+}
+
+int Layer::Parse(const char *s)
+{
+	const char *p = s;
+	SkipSpace(p);
+	if (*p == '\0' || *p == '\n' || *p == '#') {
+		return 0;
+	}
+
+	bool depthwise = false;
+	if (ReadWord(p, "conv")) _type = LAYER_CONV;
+	else if (ReadWord(p, "dwconv")) { _type = LAYER_CONV; depthwise = true; }
+	else if (ReadWord(p, "fc")) _type = LAYER_FC;
+	else if (ReadWord(p, "pool")) _type = LAYER_POOL;
+	else return -1;
+
+	// input map shape, fc layers may give the flattened size only
+	SkipSpace(p);
+	int dims[3];
+	int num = ReadDims(p, dims, 3);
+	if (num == 3) {
+		_input_map_x = dims[0];
+		_input_map_y = dims[1];
+		_input_map_num = dims[2];
+	}
+	else if (num == 1 && _type == LAYER_FC) {
+		_input_map_x = 1;
+		_input_map_y = 1;
+		_input_map_num = dims[0];
+	}
+	else {
+		return -1;
+	}
+
+	_output_map_num = -1;
+	_kernel_x = _kernel_y = 1;
+	_kernel_str = 1;
+	_pad_x = _pad_y = 0;
+	_group = 1;
+	_is_pooling = false;
+	_pool_x = _pool_y = _pool_str = 1;
+	_pool_pad_x = _pool_pad_y = 0;
+	int multiplier = 1;
+
+	// depthwise layers derive the output and the groups from
+	// the input channels and the multiplier
+	bool has_out = false, has_group = false, has_multiplier = false;
+
+	while (true) {
+		SkipSpace(p);
+		if (*p == '\0' || *p == '\n' || *p == '#') {
+			break;
+		}
+		bool ok;
+		if (ReadWord(p, "out=")) {
+			has_out = true;
+			ok = (_output_map_num = ReadInt(p)) > 0;
+		}
+		else if (ReadWord(p, "k=")) ok = ReadPair(p, _kernel_x, _kernel_y);
+		else if (ReadWord(p, "s=")) ok = (_kernel_str = ReadInt(p)) > 0;
+		else if (ReadWord(p, "p=")) {
+			if (ReadWord(p, "same")) {
+				_pad_x = _pad_y = PAD_SAME;
+				ok = true;
+			}
+			else {
+				ok = ReadPair(p, _pad_x, _pad_y);
+			}
+		}
+		else if (ReadWord(p, "g=")) {
+			has_group = true;
+			ok = (_group = ReadInt(p)) > 0;
+		}
+		else if (ReadWord(p, "m=")) {
+			has_multiplier = true;
+			ok = (multiplier = ReadInt(p)) > 0;
+		}
+		else if (ReadWord(p, "pool=")) {
+			_is_pooling = true;
+			ok = ReadPair(p, _pool_x, _pool_y) && *p++ == '/' &&
+				(_pool_str = ReadInt(p)) > 0;
+		}
+		else ok = false;
+
+		if (!ok || (*p != ' ' && *p != '\t' && *p != '\r' && *p != '\0' && *p != '\n' && *p != '#')) {
+			return -1;
+		}
+	}
+
+	if (has_multiplier && !depthwise) {
+		return -1;
+	}
+
+	if (_type == LAYER_FC) {
+		// the whole input map is one vector
+		_input_map_num *= _input_map_x * _input_map_y;
+		_input_map_x = _input_map_y = 1;
+		_kernel_x = _kernel_y = _kernel_str = 1;
+		_pad_x = _pad_y = 0;
+		_group = 1;
+	}
+	else if (_type == LAYER_POOL) {
+		// the window is given by k, s and p
+		_is_pooling = true;
+		_pool_x = _kernel_x;
+		_pool_y = _kernel_y;
+		_pool_str = _kernel_str;
+		_pool_pad_x = _pad_x;
+		_pool_pad_y = _pad_y;
+		_kernel_x = _kernel_y = _kernel_str = 1;
+		_pad_x = _pad_y = 0;
+		_output_map_num = _input_map_num;
+	}
+	else if (depthwise) {
+		if (has_out || has_group) {
+			return -1;
+		}
+		_group = _input_map_num;
+		_output_map_num = _input_map_num * multiplier;
+	}
+
+	if (_output_map_num <= 0 || _input_map_num % _group != 0 ||
+		_output_map_num % _group != 0) {
+		return -1;
+	}
+	return 1;
+}
@@ -3,8 +3,29 @@
 #include <iostream>
 #include <string>
 
+enum LayerType {
+	LAYER_CONV,		// convolution, grouped or depthwise with _group > 1
+	LAYER_FC,		// fully connected, a 1x1 convolution on a 1x1 map
+	LAYER_POOL,		// pooling only, no weights and no MAC
+};
+
+// padding for which the output size is the input size divided by
+// the stride, as assumed by the legacy network format
+const int PAD_SAME = -1;
+
+// A network file is either in the legacy format, the layer number
+// followed by "<map> <in> <out> <kernel> <stride> <group> <pool> [<size> <stride>]"
+// per layer, or in the extended format with one layer per line:
+//   conv   <x>x<y>x<c> out=<n> k=<kx>[x<ky>] s=<s> p=<p>[x<p>]|same g=<g> pool=<kx>[x<ky>]/<s>
+//   dwconv <x>x<y>x<c> k=... s=... p=... m=<channel multiplier> pool=...
+//   fc     [<x>x<y>x]<c> out=<n>
+//   pool   <x>x<y>x<c> k=<kx>[x<ky>] s=<s> p=<p>[x<p>]|same
+// Options may be left out: k=1, s=1, p=0, g=1, m=1 and no pooling.
+// dwconv takes no out= or g=, and only dwconv takes m=.
+// '#' starts a comment.
 class Layer {
 public:
+	int _type;
 	// input feature map size
 	int _input_map_x;
 	int _input_map_y;
@@ -12,6 +33,9 @@ public:
 	int _kernel_x;
 	int _kernel_y;
 	int _kernel_str;
+	// padding on each side, or PAD_SAME
+	int _pad_x;
+	int _pad_y;
 	// channel number;
 	int _input_map_num;
 	int _output_map_num;
@@ -21,10 +45,15 @@ public:
 	int _pool_x;
 	int _pool_y;
 	int _pool_str;
+	int _pool_pad_x;
+	int _pool_pad_y;
 
 	int _group;
 
 public:
+	// output map shape of the convolution, before pooling
+	void GetConvOutputShape(int &output_map_x, int &output_map_y);
+
 	void GetOutputMapShape(int &output_map_x, int &output_map_y);
 
 	int GetInputMapSize();
@@ -35,8 +64,17 @@ public:
 
 	double GetMacNum();
 
+	// parse a line of the extended format, 1 if a layer is read,
+	// 0 for a blank or comment line and -1 for a malformed one
+	int Parse(const char *s);
+
 	friend inline std::istream &operator >> (std::istream &is, Layer &l)
 	{
+		l._type = LAYER_CONV;
+		l._pad_x = PAD_SAME;
+		l._pad_y = PAD_SAME;
+		l._pool_x = l._pool_y = l._pool_str = 1;
+		l._pool_pad_x = l._pool_pad_y = PAD_SAME;
 		// input map size
 		is >> l._input_map_x;
 		l._input_map_y = l._input_map_x;
@@ -1,61 +1,530 @@
 #include "optimizer.h"
 #include "device_param.h"
+#include "ddr_profile.h"
+#include "workload.h"
+#include "profiler.h"
+#include "result_store.h"
+#include "sweep.h"
+#include "adaptive.h"
+#include "device_model.h"
+#include "monte_carlo.h"
+#include "sensitivity.h"
+#include "incremental.h"
 #include <fstream>
+#include <string>
+#include <map>
+#include <cstdio>
+#include <cstdlib>
 
 Accelerator InitializeAccelerator(int i, int j, int k, bool use_rram);
+Accelerator InitializeHybridAccelerator(int i, int j, int r, int k);
+Accelerator InitializeInterpAccelerator(int iobuf_size, int weight_size, int k,
+	int pixel_p, int channel_p);
+int SweepSingleTier(Optimizer &opt, DDRProfile &ddr, bool use_rram,
+	std::map<std::string, std::string> &args, const std::string prefix,
+	const std::string run_desc);
+int SweepHybrid(Optimizer &opt, DDRProfile &ddr,
+	std::map<std::string, std::string> &args, const std::string prefix,
+	const std::string run_desc);
+int SweepWorkload(Workload &wl, DDRProfile &ddr,
+	std::map<std::string, std::string> &args, const std::string prefix,
+	const std::string run_desc);
+void SweepAdaptive(Optimizer &opt, DDRProfile &ddr,
+	std::map<std::string, std::string> &args, const std::string prefix);
+int RunMonteCarlo(Optimizer &opt, DDRProfile &ddr,
+	std::map<std::string, std::string> &args, const std::string prefix);
+int RunSensitivity(Optimizer &opt, DDRProfile &ddr,
+	std::map<std::string, std::string> &args);
+int ExportResult(const std::string in_fn, const std::string out_fn);
+std::string RunDesc(const std::string mode, const std::vector<std::string> &files, DDRProfile &ddr);
+int Run(const std::string mode, std::map<std::string, std::string> &args, DDRProfile &ddr);
 
-int main() {
+// usage: cnn_energy_model <mode> [-net <file>] [-result <dir>] [-ddr <profile>] [-workload <file>]
+//        [-profile <json file>] [-trace <json file>]
+//        [-shard <id>/<number>] [-merge <shard number>] [-budget <evaluations>]
+//        [-incremental <cache file>]
+//        -shard and -merge only apply to ss, sr, hybrid and workload,
+//        workload and adaptive do not take -incremental
+//        cnn_energy_model mc [-dist <file>] [-samples <number>] [-threads <number>]
+//        [-seed <number>] [-method single|cross|fixed] [-config <iobuf>,<weight>,<fifo>]
+//        cnn_energy_model sens [-arch sram|rram|hybrid] [-config <iobuf>,<weight>,<fifo>]
+//        [-method single|cross|fixed] [-step <relative step>] [-threads <number>] [-top <number>]
+//        cnn_energy_model export -in <result file> -out <csv file>
+int main(int argc, char **argv) {
+	std::string mode = (argc > 1) ? argv[1] : "ss";
 
-	std::ofstream csv_file[5];
-	csv_file[0].open(".\\result\\ss_vgg11_conv.csv", std::ios::out);
-	csv_file[1].open(".\\result\\ss_vgg11_conv_f16.csv", std::ios::out);
-	csv_file[2].open(".\\result\\ss_vgg11_conv_f32.csv", std::ios::out);
-	csv_file[3].open(".\\result\\ss_vgg11_conv_f64.csv", std::ios::out);
-	csv_file[4].open(".\\result\\ss_vgg11_conv_f128.csv", std::ios::out);
+	// options come in "-key value" pairs after the mode
+	std::map<std::string, std::string> args;
+	for (int i = 2; i + 1 < argc; i += 2) {
+		args[std::string(argv[i]).substr(1)] = argv[i + 1];
+	}
+
+	// optional DDR profile, the default is the device in device_param.h
+	DDRProfile ddr;
+	if (args.count("ddr") && !ddr.LoadFromFile(args["ddr"])) {
+		return 1;
+	}
+
+	if (args.count("profile") || args.count("trace")) {
+		Profiler::Enable();
+	}
+	int ret = Run(mode, args, ddr);
+
+	if (args.count("profile")) {
+		Profiler::WriteJSON(args["profile"]);
+	}
+	if (args.count("trace")) {
+		Profiler::WriteTrace(args["trace"]);
+	}
+	return ret;
+}
+
+int Run(const std::string mode, std::map<std::string, std::string> &args, DDRProfile &ddr)
+{
+	if (mode == "export") {
+		return ExportResult(args["in"], args["out"]);
+	}
+
+	// paths are relative to the working directory, '/' works on Windows too
+	std::string result_dir = args.count("result") ? args["result"] : "result";
+
+	// shards only split the grid sweeps, and the adaptive search
+	// keeps no results to resume
+	bool grid = mode == "ss" || mode == "sr" || mode == "hybrid" || mode == "workload";
+	const char *grid_opts[] = { "shard", "merge" };
+	for (int o = 0; o < 2; o++) {
+		if (!grid && args.count(grid_opts[o])) {
+			std::cout << "-" << grid_opts[o] << " is not supported in " << mode << " mode" << std::endl;
+			return 1;
+		}
+	}
+	if (mode == "adaptive" && args.count("incremental")) {
+		std::cout << "-incremental is not supported in adaptive mode" << std::endl;
+		return 1;
+	}
+
+	if (mode == "workload") {
+		if (args.count("incremental")) {
+			std::cout << "-incremental is not supported in workload mode" << std::endl;
+			return 1;
+		}
+		// results are named after the workload file if one is given
+		std::string wl_fn = "model/workload-vgg11-alexnet.txt";
+		std::string wl_name = "vgg11_alexnet";
+		if (args.count("workload")) {
+			wl_fn = args["workload"];
+			wl_name = wl_fn.substr(wl_fn.find_last_of("/\\") + 1);
+			wl_name = wl_name.substr(0, wl_name.rfind('.'));
+		}
+
+		Workload wl;
+		{
+			PROF_SCOPE("load");
+			if (!wl.LoadFromFile(wl_fn)) {
+				return 1;
+			}
+		}
+		std::cout << "load completed!" << std::endl;
+		std::vector<std::string> files = wl._name;
+		files.insert(files.begin(), wl_fn);
+		return SweepWorkload(wl, ddr, args, result_dir + "/wl_" + wl_name,
+			RunDesc(mode, files, ddr));
+	}
+
+	// results are named after the network file if one is given
+	std::string net_fn = "model/vgg-11-conv.txt";
+	std::string net_name = "vgg11_conv";
+	if (args.count("net")) {
+		net_fn = args["net"];
+		net_name = net_fn.substr(net_fn.find_last_of("/\\") + 1);
+		net_name = net_name.substr(0, net_name.rfind('.'));
+	}
 
 	Optimizer opt;
-	opt.LoadNetFromFile(".\\model\\vgg-11-conv.txt");
+	{
+		PROF_SCOPE("load");
+		if (!opt.LoadNetFromFile(net_fn)) {
+			return 1;
+		}
+	}
 	std::cout << "load completed!" << std::endl;
 
-	for (int k = 0; k < 5; k++) {
-		for (int i = 0; i < 5; i++) {
-			for (int j = 0; j < 5; j++) {
-				std::cout << "optimization on (" << i << "," << j << ")" << std::endl;
-
-				Accelerator acc = InitializeAccelerator(i, j, k, false);
-
-				EnergyModel ene1 = opt.OptNetworkSingle(&acc);
-				ene1.PrintCSV(csv_file[k]);
-				csv_file[k] << " ,";
-				//std::cout << "Single Layer Optimization:" << std::endl;
-				//std::cout << ene1 << std::endl;
-
-				bool *weight_ready = new bool[opt._net.size()];
-				for (int i = 0; i < opt._net.size(); i++) {
-					weight_ready[i] = false;
-				}
-				EnergyModel ene2 = opt.OptNetworkCrossLayer(&acc, weight_ready);
-				ene2.PrintCSV(csv_file[k]);
-				csv_file[k] << " ,";
-				//std::cout << "Cross Layer Optimization:" << std::endl;
-				//std::cout << ene2 << std::endl;
-
-				EnergyModel ene3 = opt.OptNetworkFixedWeights(&acc);
-				ene3.PrintCSV(csv_file[k]);
-				csv_file[k] << std::endl;
-				//std::cout << "Fixed Weights Optimization:" << std::endl;
-				//std::cout << ene3 << std::endl;
-			}
-			csv_file[k] << std::endl;
+	// an edited network reuses the results of the previous run
+	IncrementalCache cache;
+	if (args.count("incremental")) {
+		bool loaded;
+		{
+			PROF_SCOPE("incremental load");
+			loaded = cache.Load(args["incremental"]);
+			cache.Diff(opt._net);
+		}
+		if (!loaded) {
+			std::cout << "no previous run in " << args["incremental"] << std::endl;
+		}
+		else if (cache.Changed()) {
+			std::cout << cache._same_num << " of " << opt._net.size() <<
+				" layers unchanged" << std::endl;
+		}
+		else {
+			std::cout << "network unchanged" << std::endl;
+		}
+		opt._inc = &cache;
+	}
+
+	int ret = 0;
+	std::string run_desc = RunDesc(mode, { net_fn }, ddr);
+	if (mode == "ss") {
+		ret = SweepSingleTier(opt, ddr, false, args, result_dir + "/ss_" + net_name, run_desc);
+	}
+	else if (mode == "sr") {
+		ret = SweepSingleTier(opt, ddr, true, args, result_dir + "/sr_" + net_name, run_desc);
+	}
+	else if (mode == "hybrid") {
+		ret = SweepHybrid(opt, ddr, args, result_dir + "/hy_" + net_name, run_desc);
+	}
+	else if (mode == "adaptive") {
+		SweepAdaptive(opt, ddr, args, result_dir + "/ad_" + net_name);
+	}
+	else if (mode == "mc") {
+		ret = RunMonteCarlo(opt, ddr, args, result_dir + "/mc_" + net_name);
+	}
+	else if (mode == "sens") {
+		ret = RunSensitivity(opt, ddr, args);
+	}
+	else {
+		std::cout << "unknown mode: " << mode << std::endl;
+		return 1;
+	}
+
+	if (args.count("incremental")) {
+		std::cout << "DP prefix reused " << cache._prefix_hit << " of " <<
+			cache._prefix_hit + cache._prefix_miss << ", " << cache.EntryNum() <<
+			" DP entries kept" << std::endl;
+		if (!cache.Save(args["incremental"])) {
+			std::cout << "cannot save " << args["incremental"] << std::endl;
+		}
+	}
+	return ret;
+}
+
+// run a sweep, or merge its shards with "-merge <shard number>".
+// "-shard <id>/<number>" only runs one shard of the grid.
+bool RunSweep(SweepDriver &sweep, std::map<std::string, std::string> &args,
+	const std::string prefix, SweepEval eval, IncrementalCache *inc)
+{
+	if (args.count("merge")) {
+		int shard_num = std::atoi(args["merge"].c_str());
+		if (shard_num < 2 || !sweep.SetShard(0, shard_num)) {
+			std::cout << "bad shard number " << args["merge"] << ", a merge needs at least 2" << std::endl;
+			return false;
+		}
+		return sweep.Merge(prefix);
+	}
+	if (args.count("shard")) {
+		std::string shard = args["shard"];
+		size_t pos = shard.find('/');
+		if (pos == std::string::npos || !sweep.SetShard(std::atoi(shard.substr(0, pos).c_str()),
+			std::atoi(shard.substr(pos + 1).c_str()))) {
+			std::cout << "bad shard " << shard << ", expected <id>/<number>" << std::endl;
+			return false;
+		}
+	}
+	// the results of an edited network replace those of the previous
+	// run, the cache is saved with the progress so a resumed run sees
+	// the network unchanged
+	if (inc != nullptr) {
+		if (inc->Changed()) {
+			std::remove(sweep.ResultFile(prefix, sweep._shard_id).c_str());
+			std::remove(sweep.ProgressFile(prefix, sweep._shard_id).c_str());
+		}
+		std::string fn = args["incremental"];
+		sweep._on_checkpoint = [inc, fn]() {
+			inc->Save(fn);
+		};
+	}
+	return sweep.Run(prefix, eval);
+}
+
+// sweep iobuf, weight buffer and fifo size with a single weight tier
+int SweepSingleTier(Optimizer &opt, DDRProfile &ddr, bool use_rram,
+	std::map<std::string, std::string> &args, const std::string prefix,
+	const std::string run_desc)
+{
+	SweepDriver sweep({ "iobuf", "weight", "fifo" }, { 5, 5, 5 },
+		{ "single", "cross", "fixed" });
+	sweep._run_desc = run_desc;
+
+	bool *weight_ready = new bool[opt._net.size()];
+	bool ok = RunSweep(sweep, args, prefix, [&](const int *keys, EnergyModel *ene) {
+		int i = keys[0], j = keys[1], k = keys[2];
+		Accelerator acc = InitializeAccelerator(i, j, k, use_rram);
+		ddr.Apply(&acc);
+		// the layer activity, evaluated once per array shape
+		opt.Precompute(&acc);
+
+		ene[0] = opt.OptNetworkSingle(&acc);
+
+		for (int l = 0; l < opt._net.size(); l++) {
+			weight_ready[l] = false;
+		}
+		ene[1] = opt.OptNetworkCrossLayer(&acc, weight_ready);
+
+		ene[2] = opt.OptNetworkFixedWeights(&acc);
+	}, opt._inc);
+	delete[] weight_ready;
+	return ok ? 0 : 1;
+}
+
+// sweep iobuf, SRAM weight tier, RRAM pinned tier and fifo size
+int SweepHybrid(Optimizer &opt, DDRProfile &ddr,
+	std::map<std::string, std::string> &args, const std::string prefix,
+	const std::string run_desc)
+{
+	SweepDriver sweep({ "iobuf", "weight", "rram", "fifo" }, { 5, 5, 5, 5 }, { "fixed" });
+	sweep._run_desc = run_desc;
+
+	bool ok = RunSweep(sweep, args, prefix, [&](const int *keys, EnergyModel *ene) {
+		int i = keys[0], j = keys[1], r = keys[2], k = keys[3];
+		Accelerator acc = InitializeHybridAccelerator(i, j, r, k);
+		ddr.Apply(&acc);
+		// the layer activity, evaluated once per array shape
+		opt.Precompute(&acc);
+		ene[0] = opt.OptNetworkFixedWeights(&acc);
+	}, opt._inc);
+	return ok ? 0 : 1;
+}
+
+// sweep iobuf and weight buffer size for a multi-network workload,
+// the result is the energy and time of one frame
+int SweepWorkload(Workload &wl, DDRProfile &ddr,
+	std::map<std::string, std::string> &args, const std::string prefix,
+	const std::string run_desc)
+{
+	SweepDriver sweep({ "iobuf", "weight" }, { 5, 5 }, { "frame" });
+	sweep._run_desc = run_desc;
+
+	Accelerator best_acc;
+	double best_ene = -1;
+	bool ok = RunSweep(sweep, args, prefix, [&](const int *keys, EnergyModel *ene) {
+		int i = keys[0], j = keys[1];
+		Accelerator acc = InitializeAccelerator(i, j, 0, false);
+		ddr.Apply(&acc);
+		ene[0] = wl.OptWorkload(&acc);
+
+		if (best_ene < 0 || ene[0].Total() < best_ene) {
+			best_ene = ene[0].Total();
+			best_acc = acc;
+		}
+	}, nullptr);
+
+	// report the pinning of the best configuration
+	if (best_ene >= 0) {
+		wl.OptWorkload(&best_acc);
+		wl.Report(std::cout);
+	}
+	return ok ? 0 : 1;
+}
+
+// search interpolated buffer sizes, fifo size and free parallelism
+// factors coarse to fine under an evaluation budget
+void SweepAdaptive(Optimizer &opt, DDRProfile &ddr,
+	std::map<std::string, std::string> &args, const std::string prefix)
+{
+	std::vector<DesignDim> dims = {
+		{ "iobuf", 14, 18, true },		// 16KB - 256KB per bank
+		{ "weight", 14, 18, true },
+		{ "fifo", 0, 4, false },		// index in FIFO_SIZE
+		{ "pixel_p", 2, 5, true },		// 4 - 32
+		{ "channel_p", 2, 5, true },
+	};
+	int budget = args.count("budget") ? std::stoi(args["budget"]) : 1000;
+
+	AdaptiveSweep sweep(dims, budget);
+	sweep.Run([&](const int *config) {
+		Accelerator acc = InitializeInterpAccelerator(config[0], config[1], config[2],
+			config[3], config[4]);
+		ddr.Apply(&acc);
+		return opt.OptNetworkFixedWeights(&acc);
+	});
+
+	ResultSink sink;
+	std::vector<std::string> key_names;
+	for (int d = 0; d < dims.size(); d++) {
+		key_names.push_back(dims[d]._name);
+	}
+	if (sink.Open(prefix + ".bin", key_names, { "fixed" })) {
+		for (int p = 0; p < sweep._points.size(); p++) {
+			sink.Append(sweep._points[p]._config.data(), &sweep._points[p]._ene);
 		}
+		sink.Close();
+	}
+
+	std::cout << sweep._points.size() << " evaluations, full grid " <<
+		sweep.FullGridSize() << std::endl;
+	std::vector<int> front = sweep.ParetoFront();
+	std::cout << "Pareto frontier (energy uJ, time us):" << std::endl;
+	for (int i = 0; i < front.size(); i++) {
+		DesignPoint &p = sweep._points[front[i]];
+		for (int d = 0; d < dims.size(); d++) {
+			std::cout << dims[d]._name << "=" << p._config[d] << " ";
+		}
+		std::cout << "\t" << p._ene.Total() / 1e6 << "\t" << p._ene._time << std::endl;
+	}
+	if (sweep.Best() >= 0) {
+		std::cout << "Best:" << std::endl << sweep._points[sweep.Best()]._ene;
+	}
+}
+
+// optimizer method of "-method single|cross|fixed", fixed by default
+int ParseMethod(std::map<std::string, std::string> &args)
+{
+	std::string method = args.count("method") ? args["method"] : "fixed";
+	return (method == "single") ? MC_SINGLE : (method == "cross") ? MC_CROSS : MC_FIXED;
+}
+
+// bank indices of "-config <iobuf>,<weight>,<fifo>" in the device tables
+// of device_param.h, 2,2,2 by default. false if malformed.
+bool ParseConfig(std::map<std::string, std::string> &args, int &i, int &j, int &k)
+{
+	i = j = k = 2;
+	if (!args.count("config")) {
+		return true;
+	}
+	const int bank_num = sizeof(SRAM_UNIT_SIZE) / sizeof(SRAM_UNIT_SIZE[0]);
+	std::string config = args["config"];
+	int len = 0;
+	if (sscanf(config.c_str(), "%d,%d,%d%n", &i, &j, &k, &len) != 3 || len != config.size() ||
+		i < 0 || i >= bank_num || j < 0 || j >= bank_num || k < 0 || k >= bank_num) {
+		std::cout << "bad config " << config << ", expected <iobuf>,<weight>,<fifo> in 0.." <<
+			bank_num - 1 << std::endl;
+		return false;
+	}
+	return true;
+}
+
+// compare SRAM, RRAM and hybrid weight buffers of one configuration
+// under uncertain device parameters
+int RunMonteCarlo(Optimizer &opt, DDRProfile &ddr,
+	std::map<std::string, std::string> &args, const std::string prefix)
+{
+	MonteCarlo mc;
+	if (!mc.LoadDistFile(args.count("dist") ? args["dist"] :
+		"profile/mc-device-estimate.txt")) {
+		return 1;
+	}
+	if (args.count("threads")) {
+		mc._thread_num = std::atoi(args["threads"].c_str());
+		if (mc._thread_num < 1) {
+			std::cout << "bad thread number " << args["threads"] << std::endl;
+			return 1;
+		}
+	}
+	if (args.count("seed")) {
+		mc._seed = std::stoull(args["seed"]);
+	}
+	mc._method = ParseMethod(args);
+	int sample_num = args.count("samples") ? std::stoi(args["samples"]) : 10000;
+
+	int i, j, k;
+	if (!ParseConfig(args, i, j, k)) {
+		return 1;
+	}
+	// the samples run concurrently
+	opt._verbose = false;
+
+	MCCandidate sram = { "sram", InitializeAccelerator(i, j, k, false), "sram", "sram", "" };
+	MCCandidate rram = { "rram", InitializeAccelerator(i, j, k, true), "sram", "rram", "" };
+	MCCandidate hybrid = { "hybrid", InitializeHybridAccelerator(i, j, j, k), "sram", "sram", "rram" };
+	mc._cands = { sram, rram, hybrid };
+	for (int c = 0; c < mc._cands.size(); c++) {
+		ddr.Apply(&mc._cands[c]._acc);
 	}
 
-	csv_file[0].close();
-	csv_file[1].close();
-	csv_file[2].close();
-	csv_file[3].close();
-	csv_file[4].close();	
+	mc.Run(&opt, sample_num);
+	mc.Report(std::cout);
 
+	// energy of every sample and candidate, replacing an earlier run
+	ResultSink sink;
+	std::vector<std::string> names;
+	for (int c = 0; c < mc._cands.size(); c++) {
+		names.push_back(mc._cands[c]._name);
+	}
+	if (sink.Open(prefix + ".bin", { "sample" }, names)) {
+		for (int s = 0; s < sample_num; s++) {
+			sink.Append(&s, &mc._ene[(long long)s * mc._cands.size()]);
+		}
+		sink.Close();
+	}
+	return 0;
+}
+
+// rank the parameters of one configuration by their effect on the
+// optimized energy and latency
+int RunSensitivity(Optimizer &opt, DDRProfile &ddr,
+	std::map<std::string, std::string> &args)
+{
+	int i, j, k;
+	if (!ParseConfig(args, i, j, k)) {
+		return 1;
+	}
+	std::string arch = args.count("arch") ? args["arch"] : "sram";
+	Accelerator acc = (arch == "hybrid") ? InitializeHybridAccelerator(i, j, j, k) :
+		InitializeAccelerator(i, j, k, arch == "rram");
+	ddr.Apply(&acc);
+	opt._verbose = false;
+
+	Sensitivity sens;
+	sens._method = ParseMethod(args);
+	if (args.count("step")) {
+		sens._step = std::stod(args["step"]);
+	}
+	if (args.count("threads")) {
+		sens._thread_num = std::atoi(args["threads"].c_str());
+		if (sens._thread_num < 1) {
+			std::cout << "bad thread number " << args["threads"] << std::endl;
+			return 1;
+		}
+	}
+	sens.AddParams(&acc);
+	sens.Run(&opt, &acc);
+	sens.Report(std::cout, args.count("top") ? std::stoi(args["top"]) : 5);
+	return 0;
+}
+
+// the inputs of a sweep besides its grid, kept with the results so
+// that a sweep only resumes its own. Files are identified by their
+// contents.
+std::string RunDesc(const std::string mode, const std::vector<std::string> &files, DDRProfile &ddr)
+{
+	// FNV-1a
+	unsigned long long h = 14695981039346656037ULL;
+	for (int f = 0; f < files.size(); f++) {
+		std::ifstream is(files[f], std::ios::in | std::ios::binary);
+		char buf[4096];
+		while (is.read(buf, sizeof(buf)) || is.gcount() > 0) {
+			for (int i = 0; i < is.gcount(); i++) {
+				h = (h ^ (unsigned char)buf[i]) * 1099511628211ULL;
+			}
+		}
+		h = (h ^ 0xff) * 1099511628211ULL;
+	}
+	char hash[32];
+	snprintf(hash, sizeof(hash), "%016llx", h);
+	return "mode=" + mode + " net=" + hash + " ddr=" + ddr.Describe();
+}
+
+// convert a result file to CSV
+int ExportResult(const std::string in_fn, const std::string out_fn)
+{
+	ResultReader reader;
+	if (!reader.Open(in_fn)) {
+		std::cout << "cannot read result file " << in_fn << std::endl;
+		return 1;
+	}
+	std::ofstream os(out_fn, std::ios::out);
+	reader.ExportCSV(os);
+	os.close();
+	std::cout << reader.RowNum() << " rows exported" << std::endl;
 	return 0;
 }
 
@@ -104,5 +573,47 @@ Accelerator InitializeAccelerator(int i, int j, int k, bool use_rram)
 	acc._acc_buf._unit_rd_ene = FIFO_UNIT_RD_ENE[k];
 	acc._acc_buf._unit_wr_ene = FIFO_UNIT_WR_ENE[k];
 
+	return acc;
+}
+
+// SRAM weight buffer j for streamed weights, RRAM r for pinned weights
+Accelerator InitializeHybridAccelerator(int i, int j, int r, int k)
+{
+	Accelerator acc = InitializeAccelerator(i, j, k, false);
+	acc._use_pinned = true;
+	acc._pinned._size = RRAM_UNIT_SIZE[r] * PIXEL_P;
+	acc._pinned._rd_bw = RRAM_UNIT_RD_BW[r] * PIXEL_P;
+	acc._pinned._wr_bw = RRAM_UNIT_WR_BW[r] * PIXEL_P;
+	acc._pinned._unit_rd_ene = RRAM_UNIT_RD_ENE[r];
+	acc._pinned._unit_wr_ene = RRAM_UNIT_WR_ENE[r];
+	acc._pinned._bg_pwr = RRAM_UNIT_BG_PWR[r] * PIXEL_P;
+	return acc;
+}
+
+// interpolated SRAM banks of the given size, fifo k, free parallelism
+Accelerator InitializeInterpAccelerator(int iobuf_size, int weight_size, int k,
+	int pixel_p, int channel_p)
+{
+	Accelerator acc = InitializeAccelerator(0, 0, k, false);
+
+	BufferModel iobuf = InterpolateSRAM(iobuf_size);
+	acc._iobuf._size = iobuf._size * pixel_p;
+	acc._iobuf._rd_bw = iobuf._rd_bw * pixel_p;
+	acc._iobuf._wr_bw = iobuf._wr_bw * pixel_p;
+	acc._iobuf._unit_rd_ene = iobuf._unit_rd_ene;
+	acc._iobuf._unit_wr_ene = iobuf._unit_wr_ene;
+	acc._iobuf._bg_pwr = iobuf._bg_pwr * pixel_p * 2;
+
+	BufferModel weight = InterpolateSRAM(weight_size);
+	acc._weight._size = weight._size * pixel_p;
+	acc._weight._rd_bw = weight._rd_bw * pixel_p;
+	acc._weight._wr_bw = weight._wr_bw * pixel_p;
+	acc._weight._unit_rd_ene = weight._unit_rd_ene;
+	acc._weight._unit_wr_ene = weight._unit_wr_ene;
+	acc._weight._bg_pwr = weight._bg_pwr * pixel_p;
+
+	acc._input_map_p = channel_p;
+	acc._output_map_p = channel_p;
+	acc._pixel_p = pixel_p;
 	return acc;
 }
\ No newline at end of file
@@ -15,6 +15,33 @@ public:
 	// speed model
 	double _rd_bw;		// Mega datum per second
 	double _wr_bw;		// Mega datum per second
+
+public:
+	BufferModel()
+	{
+		_size = 0;
+		_unit_rd_ene = 0.0;
+		_unit_wr_ene = 0.0;
+		_bg_pwr = 0.0;
+		_rd_bw = 0.0;
+		_wr_bw = 0.0;
+	}
+};
+
+// DDR row buffer model, charges row activations by access pattern
+class RowBufferModel {
+public:
+	double _row_size;	// datum per open row of a rank, 0 for the flat model
+	double _act_ene;	// pJ per row activation
+	double _active_pwr;	// mW on top of background at 100% bandwidth usage
+
+public:
+	RowBufferModel()
+	{
+		_row_size = 0.0;
+		_act_ene = 0.0;
+		_active_pwr = 0.0;
+	}
 };
 
 class Accelerator {
@@ -22,6 +49,12 @@ public:
 	BufferModel _iobuf;
 	BufferModel _weight;
 	BufferModel _ddr;
+	RowBufferModel _ddr_row;
+
+	// optional second weight tier (e.g. RRAM) holding pinned weights,
+	// in which case _weight only holds the streamed weights
+	BufferModel _pinned;
+	bool _use_pinned;
 
 	// MAC array model
 	int _input_map_p;
@@ -32,8 +65,23 @@ public:
 	BufferModel _acc_buf;
 
 public:
+	Accelerator()
+	{
+		_use_pinned = false;
+		_input_map_p = 0;
+		_output_map_p = 0;
+		_pixel_p = 0;
+		_mac_ene = 0.0;
+		_mac_freq = 0.0;
+	}
+
 	double BackgroundPower() {
-		return _iobuf._bg_pwr + _weight._bg_pwr + _ddr._bg_pwr;
+		return _iobuf._bg_pwr + _weight._bg_pwr + _pinned._bg_pwr + _ddr._bg_pwr;
+	}
+
+	// buffer where weights marked as ready are kept
+	BufferModel &PinBuffer() {
+		return _use_pinned ? _pinned : _weight;
 	}
 
 	double ReadWeightBw() {
@@ -63,6 +111,14 @@ public:
 	double _bg;
 	double _calc;
 
+	// schedule time and the part of it DDR is busy (us)
+	double _time;
+	double _ddr_time;
+
+	// id of the schedule decisions that produced this energy,
+	// 0 if no decision is involved
+	unsigned long long _schedule;
+
 public:
 	EnergyModel()
 	{
@@ -77,6 +133,11 @@ public:
 
 		_bg = 0.0;
 		_calc = 0.0;
+
+		_time = 0.0;
+		_ddr_time = 0.0;
+
+		_schedule = 0;
 	}
 
 	EnergyModel operator+(EnergyModel &b)
@@ -94,10 +155,39 @@ public:
 		c._bg = _bg + b._bg;
 		c._calc = _calc + b._calc;
 
+		c._time = _time + b._time;
+		c._ddr_time = _ddr_time + b._ddr_time;
+
+		// the schedule id is only mixed at the decisions, see AddSchedule
+		c._schedule = _schedule;
+
 		return c;
 	}
 
-	EnergyModel operator*(int p)
+	EnergyModel operator-(EnergyModel &b)
+	{
+		EnergyModel c;
+		c._rd_iobuf = _rd_iobuf - b._rd_iobuf;
+		c._wr_iobuf = _wr_iobuf - b._wr_iobuf;
+
+		c._rd_weight = _rd_weight - b._rd_weight;
+		c._wr_weight = _wr_weight - b._wr_weight;
+
+		c._rd_ddr = _rd_ddr - b._rd_ddr;
+		c._wr_ddr = _wr_ddr - b._wr_ddr;
+
+		c._bg = _bg - b._bg;
+		c._calc = _calc - b._calc;
+
+		c._time = _time - b._time;
+		c._ddr_time = _ddr_time - b._ddr_time;
+
+		c._schedule = _schedule;
+
+		return c;
+	}
+
+	EnergyModel operator*(double p)
 	{
 		EnergyModel c;
 		c._rd_iobuf = _rd_iobuf * p;
@@ -112,6 +202,11 @@ public:
 		c._bg = _bg * p;
 		c._calc = _calc * p;
 
+		c._time = _time * p;
+		c._ddr_time = _ddr_time * p;
+
+		c._schedule = _schedule;
+
 		return c;
 	}
 
@@ -122,6 +217,26 @@ public:
 			_rd_ddr + _wr_ddr + _bg + _calc;
 	}
 
+	// mix a schedule decision into the schedule id
+	void AddDecision(unsigned long long d)
+	{
+		_schedule ^= d + 0x9e3779b97f4a7c15ULL + (_schedule << 6) + (_schedule >> 2);
+	}
+
+	// mix the schedule id of a part of this schedule
+	void AddSchedule(unsigned long long s)
+	{
+		if (s != 0) {
+			AddDecision(s);
+		}
+	}
+
+	// fraction of the schedule time DDR is transferring
+	double DDRUtilization()
+	{
+		return (_time > 0) ? _ddr_time / _time : 0.0;
+	}
+
 	friend std::ostream& operator << (std::ostream &os, EnergyModel &ene)
 	{
 		double total = ene.Total();
@@ -136,6 +251,7 @@ public:
 		os << "background\t" << ene._bg << "\t(" << ene._bg / total * 100 << "%)\t" << std::endl;
 		os << "calculate\t" << ene._calc << "\t(" << ene._calc / total * 100 << "%)\t" << std::endl;
 		os << "Total:\t" << total << std::endl;
+		os << "Time(us):\t" << ene._time << "\t(DDR " << ene.DDRUtilization() * 100 << "%)\t" << std::endl;
 		return os;
 	}
 
@@ -0,0 +1,256 @@
+#include "monte_carlo.h"
+#include "profiler.h"
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <map>
+#include <algorithm>
+#include <cmath>
+
+double ParamDist::Sample(std::mt19937_64 &rng)
+{
+	if (_type == DIST_UNIFORM) {
+		std::uniform_real_distribution<double> dist(_a, _b);
+		return dist(rng);
+	}
+	std::normal_distribution<double> dist(0.0, _a);
+	if (_type == DIST_LOGNORMAL) {
+		return std::exp(dist(rng));
+	}
+	double f = 1.0 + dist(rng);
+	return (f < 0.01) ? 0.01 : f;
+}
+
+MonteCarlo::MonteCarlo()
+{
+	_method = MC_FIXED;
+	_thread_num = std::thread::hardware_concurrency();
+	if (_thread_num <= 0) {
+		_thread_num = 1;
+	}
+	_seed = 1;
+	_chunk_size = 256;
+	_sample_num = 0;
+}
+
+bool MonteCarlo::LoadDistFile(const std::string fn)
+{
+	std::ifstream is(fn, std::ios::in);
+	if (!is) {
+		std::cout << "cannot open distribution file " << fn << std::endl;
+		return false;
+	}
+
+	_dists.clear();
+	std::string line;
+	while (std::getline(is, line)) {
+		line = line.substr(0, line.find('#'));
+		std::istringstream ls(line);
+		std::string param, type;
+		if (!(ls >> param >> type)) {
+			continue;
+		}
+
+		ParamDist d;
+		int pos = param.find('.');
+		d._device = param.substr(0, pos);
+		d._field = (pos < 0) ? "" : param.substr(pos + 1);
+		d._a = 0.0;
+		d._b = 0.0;
+		ls >> d._a >> d._b;
+		if (type == "normal") d._type = DIST_NORMAL;
+		else if (type == "uniform") d._type = DIST_UNIFORM;
+		else if (type == "lognormal") d._type = DIST_LOGNORMAL;
+		else {
+			std::cout << "unknown distribution " << type << " in " << fn << std::endl;
+			return false;
+		}
+		_dists.push_back(d);
+	}
+	return true;
+}
+
+void MonteCarlo::_applyBuffer(BufferModel &buf, const std::string dev,
+	const std::vector<double> &factor)
+{
+	for (int d = 0; d < _dists.size(); d++) {
+		if (_dists[d]._device != dev) {
+			continue;
+		}
+		const std::string &f = _dists[d]._field;
+		if (f == "rd_ene") buf._unit_rd_ene *= factor[d];
+		else if (f == "wr_ene") buf._unit_wr_ene *= factor[d];
+		else if (f == "bg_pwr") buf._bg_pwr *= factor[d];
+		else if (f == "rd_bw") buf._rd_bw *= factor[d];
+		else if (f == "wr_bw") buf._wr_bw *= factor[d];
+	}
+}
+
+Accelerator MonteCarlo::_apply(const MCCandidate &cand, const std::vector<double> &factor)
+{
+	Accelerator acc = cand._acc;
+	_applyBuffer(acc._iobuf, cand._iobuf_dev, factor);
+	_applyBuffer(acc._weight, cand._weight_dev, factor);
+	if (acc._use_pinned) {
+		_applyBuffer(acc._pinned, cand._pinned_dev, factor);
+	}
+	_applyBuffer(acc._ddr, "ddr", factor);
+	_applyBuffer(acc._acc_buf, "fifo", factor);
+
+	for (int d = 0; d < _dists.size(); d++) {
+		if (_dists[d]._device == "mac") {
+			if (_dists[d]._field == "ene") acc._mac_ene *= factor[d];
+			else if (_dists[d]._field == "freq") acc._mac_freq *= factor[d];
+		}
+		else if (_dists[d]._device == "ddr" && _dists[d]._field == "act_ene") {
+			acc._ddr_row._act_ene *= factor[d];
+		}
+	}
+	return acc;
+}
+
+void MonteCarlo::_runThread(Optimizer *opt, int thread_id)
+{
+	PROF_SCOPE("MonteCarlo");
+	int cand_num = _cands.size();
+	std::vector<double> factor(_dists.size());
+	bool *weight_ready = new bool[opt->_net.size()];
+
+	int chunk_num = (_sample_num + _chunk_size - 1) / _chunk_size;
+	for (int chunk = thread_id; chunk < chunk_num; chunk += _thread_num) {
+		std::seed_seq seq = { (unsigned int)_seed, (unsigned int)(_seed >> 32), (unsigned int)chunk };
+		std::mt19937_64 rng(seq);
+
+		int end = MIN((chunk + 1) * _chunk_size, _sample_num);
+		for (int s = chunk * _chunk_size; s < end; s++) {
+			for (int d = 0; d < _dists.size(); d++) {
+				factor[d] = _dists[d].Sample(rng);
+			}
+			for (int c = 0; c < cand_num; c++) {
+				Accelerator acc = _apply(_cands[c], factor);
+				EnergyModel &ene = _ene[(long long)s * cand_num + c];
+				if (_method == MC_SINGLE) {
+					ene = opt->OptNetworkSingle(&acc);
+				}
+				else if (_method == MC_CROSS) {
+					for (int l = 0; l < opt->_net.size(); l++) {
+						weight_ready[l] = false;
+					}
+					ene = opt->OptNetworkCrossLayer(&acc, weight_ready);
+				}
+				else {
+					ene = opt->OptNetworkFixedWeights(&acc);
+				}
+			}
+		}
+	}
+	delete[] weight_ready;
+}
+
+void MonteCarlo::Run(Optimizer *opt, int sample_num)
+{
+	// the samples only change unit energies, bandwidths and the
+	// clock, so the layer activity of each candidate is shared
+	for (int c = 0; c < _cands.size(); c++) {
+		opt->Precompute(&_cands[c]._acc);
+	}
+
+	_sample_num = sample_num;
+	_ene.assign((long long)sample_num * _cands.size(), EnergyModel());
+
+	// a thread number below 1 would leave every sample unevaluated
+	_thread_num = std::max(_thread_num, 1);
+	std::vector<std::thread> threads;
+	for (int t = 0; t < _thread_num; t++) {
+		threads.push_back(std::thread(&MonteCarlo::_runThread, this, opt, t));
+	}
+	for (int t = 0; t < threads.size(); t++) {
+		threads[t].join();
+	}
+}
+
+// p-th percentile of sorted values
+static double Percentile(std::vector<double> &v, double p)
+{
+	int i = (int)(p * (v.size() - 1) + 0.5);
+	return v[i];
+}
+
+static double Mean(std::vector<double> &v)
+{
+	double sum = 0;
+	for (int i = 0; i < v.size(); i++) {
+		sum += v[i];
+	}
+	return sum / v.size();
+}
+
+static double StdDev(std::vector<double> &v, double mean)
+{
+	double sum = 0;
+	for (int i = 0; i < v.size(); i++) {
+		sum += (v[i] - mean) * (v[i] - mean);
+	}
+	return std::sqrt(sum / v.size());
+}
+
+void MonteCarlo::Report(std::ostream &os)
+{
+	int cand_num = _cands.size();
+	if (_sample_num == 0 || cand_num == 0) {
+		return;
+	}
+
+	// candidate with the least energy in each sample
+	std::vector<int> wins(cand_num, 0);
+	for (int s = 0; s < _sample_num; s++) {
+		int best = 0;
+		for (int c = 1; c < cand_num; c++) {
+			if (_ene[(long long)s * cand_num + c].Total() <
+				_ene[(long long)s * cand_num + best].Total()) {
+				best = c;
+			}
+		}
+		wins[best]++;
+	}
+
+	os << "===================================" << std::endl;
+	os << _sample_num << " samples" << std::endl;
+	for (int c = 0; c < cand_num; c++) {
+		std::vector<double> ene(_sample_num), time(_sample_num);
+		std::map<unsigned long long, int> schedules;
+		for (int s = 0; s < _sample_num; s++) {
+			EnergyModel &e = _ene[(long long)s * cand_num + c];
+			ene[s] = e.Total() / 1e6;
+			time[s] = e._time;
+			schedules[e._schedule]++;
+		}
+		std::sort(ene.begin(), ene.end());
+		std::sort(time.begin(), time.end());
+		double ene_mean = Mean(ene);
+		double time_mean = Mean(time);
+
+		os << "-----------------------------------" << std::endl;
+		os << _cands[c]._name << "\twins " << wins[c] * 100.0 / _sample_num << "%" << std::endl;
+		os << "\tmean\tstd\tp5\tp50\tp95" << std::endl;
+		os << "energy(uJ)\t" << ene_mean << "\t" <<
+			StdDev(ene, ene_mean) << "\t" <<
+			Percentile(ene, 0.05) << "\t" << Percentile(ene, 0.5) << "\t" <<
+			Percentile(ene, 0.95) << std::endl;
+		os << "time(us)\t" << time_mean << "\t" <<
+			StdDev(time, time_mean) << "\t" <<
+			Percentile(time, 0.05) << "\t" << Percentile(time, 0.5) << "\t" <<
+			Percentile(time, 0.95) << std::endl;
+
+		// the most frequent schedules
+		std::vector<std::pair<int, unsigned long long> > count;
+		for (auto it = schedules.begin(); it != schedules.end(); it++) {
+			count.push_back(std::make_pair(it->second, it->first));
+		}
+		std::sort(count.rbegin(), count.rend());
+		os << schedules.size() << " schedules" << std::endl;
+		for (int i = 0; i < count.size() && i < 5; i++) {
+			os << "\t" << count[i].second << "\t" << count[i].first * 100.0 / _sample_num << "%" << std::endl;
+		}
+	}
+}
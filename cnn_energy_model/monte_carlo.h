@@ -0,0 +1,85 @@
+#pragma once
+#include "optimizer.h"
+#include <vector>
+#include <string>
+#include <random>
+#include <iostream>
+
+enum DistType {
+	DIST_NORMAL,	// factor ~ N(1, _a), at least 0.01
+	DIST_UNIFORM,	// factor ~ U(_a, _b)
+	DIST_LOGNORMAL,	// ln(factor) ~ N(0, _a)
+};
+
+// distribution of a device parameter as a factor on its nominal value.
+// The parameter is "<device>.<field>", the device is sram, rram, ddr,
+// fifo or mac and the field is rd_ene, wr_ene, bg_pwr, rd_bw or wr_bw,
+// act_ene for ddr, ene or freq for mac.
+class ParamDist {
+public:
+	std::string _device;
+	std::string _field;
+	int _type;
+	double _a;
+	double _b;
+
+public:
+	double Sample(std::mt19937_64 &rng);
+};
+
+// an accelerator to evaluate and the device of each of its buffers
+class MCCandidate {
+public:
+	std::string _name;
+	Accelerator _acc;
+	std::string _iobuf_dev;
+	std::string _weight_dev;
+	std::string _pinned_dev;
+};
+
+enum MCMethod {
+	MC_SINGLE,		// OptNetworkSingle
+	MC_CROSS,		// OptNetworkCrossLayer without pinned weights
+	MC_FIXED,		// OptNetworkFixedWeights
+};
+
+// Monte Carlo analysis of the optimized energy under uncertain device
+// parameters. Every sample draws one factor per distribution and applies
+// it to all the candidates, so the candidates are compared on the same
+// devices. Samples are split into chunks with their own random stream
+// seeded by (seed, chunk), so the result does not depend on the threads.
+class MonteCarlo {
+public:
+	std::vector<ParamDist> _dists;
+	std::vector<MCCandidate> _cands;
+	int _method;
+	int _thread_num;
+	unsigned long long _seed;
+	int _chunk_size;
+
+	// result of sample s on candidate c at s * candidate number + c
+	int _sample_num;
+	std::vector<EnergyModel> _ene;
+
+public:
+	MonteCarlo();
+
+	// load distributions, one "<param> <normal|uniform|lognormal> a [b]"
+	// per line, '#' starts a comment
+	bool LoadDistFile(const std::string fn);
+
+	// run the optimizer on every candidate for sample_num samples
+	void Run(Optimizer *opt, int sample_num);
+
+	// energy and latency distribution, wins and schedules per candidate
+	void Report(std::ostream &os);
+
+private:
+	// a candidate with the sampled factors applied
+	Accelerator _apply(const MCCandidate &cand, const std::vector<double> &factor);
+
+	void _applyBuffer(BufferModel &buf, const std::string dev, const std::vector<double> &factor);
+
+	// run the chunks thread_id, thread_id + _thread_num, ...
+	void _runThread(Optimizer *opt, int thread_id);
+};
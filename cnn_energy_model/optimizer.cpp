@@ -1,46 +1,165 @@
 #include "optimizer.h"
+#include "profiler.h"
+#include "shape_eval.h"
+#include "incremental.h"
 #include <iostream>
 #include <climits>
 #include <fstream>
+#include <cstring>
 
 #define MAX(X, Y) (((X) > (Y)) ? (X) : (Y))
 #define CEIL_DIV(X, Y) (((X) + (Y) - 1) / (Y))
 #define ALIGN(X, BASE) ((BASE) * (CEIL_DIV((X), (BASE))))
 
+OptScratch::OptScratch()
+{
+	_cross_size = 0;
+	_opt_ene = nullptr;
+	_on_chip_ene = nullptr;
+	_calc_time = nullptr;
+	_fits_in_buf = nullptr;
+	_cut = nullptr;
+	_input_ready = nullptr;
+	_pin_size = 0;
+	_weight_ready = nullptr;
+}
+
+OptScratch::~OptScratch()
+{
+	ReserveCross(0);
+	ReservePin(0);
+}
+
+void OptScratch::ReserveCross(int layer_num)
+{
+	if (layer_num > 0 && layer_num <= _cross_size) {
+		return;
+	}
+	delete[] _opt_ene;
+	delete[] _on_chip_ene;
+	delete[] _calc_time;
+	delete[] _fits_in_buf;
+	delete[] _cut;
+	delete[] _input_ready;
+	_cross_size = layer_num;
+	if (layer_num == 0) {
+		_opt_ene = nullptr;
+		_on_chip_ene = nullptr;
+		_calc_time = nullptr;
+		_fits_in_buf = nullptr;
+		_cut = nullptr;
+		_input_ready = nullptr;
+		return;
+	}
+	_opt_ene = new EnergyModel[layer_num];
+	_on_chip_ene = new EnergyModel[layer_num];
+	_calc_time = new double[layer_num];
+	_fits_in_buf = new bool[layer_num];
+	_cut = new int[layer_num];
+	_input_ready = new bool[layer_num + 1];
+}
+
+void OptScratch::ReservePin(int layer_num)
+{
+	if (layer_num > 0 && layer_num <= _pin_size) {
+		return;
+	}
+	delete[] _weight_ready;
+	_pin_size = layer_num;
+	_weight_ready = (layer_num == 0) ? nullptr : new bool[(2 * layer_num + 1) * layer_num];
+}
+
+OptScratch *OptScratch::Get()
+{
+	static thread_local OptScratch scratch;
+	return &scratch;
+}
+
+Optimizer::Optimizer()
+{
+	_verbose = true;
+	_max_pin_search = 16;
+	_inc = nullptr;
+}
+
 Optimizer::~Optimizer()
 {
 	if (!_net.empty()) {
-		for each (Layer *l in _net) {
+		for (Layer *l : _net) {
 			delete l;
 		}
 	}
 	_net.clear();
 }
 
-void Optimizer::LoadNetFromFile(const std::string fn) {
+bool Optimizer::LoadNetFromFile(const std::string fn) {
+	std::ifstream is(fn, std::ios::in);
+	if (!is) {
+		if (_verbose) {
+			std::cout << "cannot open network file " << fn << std::endl;
+		}
+		return false;
+	}
+	return LoadNet(is);
+}
+
+bool Optimizer::LoadNet(std::istream &is) {
 	if (!_net.empty()) {
-		for each (Layer *l in _net) {
+		for (Layer *l : _net) {
 			delete l;
 		}
 	}
 	_net.clear();
+	ClearPrecompute();
 
-	int layer_num;
-	std::ifstream is(fn, std::ios::in);
+	// legacy files start with the layer number
+	is >> std::ws;
+	if (is.peek() < '0' || is.peek() > '9') {
+		return _loadExtendedNet(is);
+	}
+
+	int layer_num = 0;
 	is >> layer_num;
-	_net.resize(layer_num);
+	if (!is || layer_num <= 0) {
+		return false;
+	}
 
 	for (int i = 0; i < layer_num; i++) {
 		Layer *l = new Layer;
 		is >> (*l);
-		_net[i] = l;
+		_net.push_back(l);
+		if (!is) {
+			return false;
+		}
 	}
-	return;
+	return true;
+}
+
+bool Optimizer::_loadExtendedNet(std::istream &is)
+{
+	std::string line;
+	int line_num = 0;
+	while (std::getline(is, line)) {
+		line_num++;
+		Layer l;
+		int res = l.Parse(line.c_str());
+		if (res < 0) {
+			if (_verbose) {
+				std::cout << "malformed layer at line " << line_num << ": " << line << std::endl;
+			}
+			return false;
+		}
+		if (res > 0) {
+			_net.push_back(new Layer(l));
+		}
+	}
+	return !_net.empty();
 }
 
 // optimize the schedule of a single layer to minimize energy
 // the optimized energy is returned
-EnergyModel Optimizer::_optSingleLayer(Accelerator *acc, Layer *l, bool input_ready, bool weight_ready)
+EnergyModel Optimizer::_optSingleLayer(Accelerator *acc, Layer *l, const LayerActivity &act,
+	bool input_ready, bool weight_ready)
 {
 	EnergyModel ene;
 
@@ -50,35 +169,48 @@ EnergyModel Optimizer::_optSingleLayer(Accelerator *acc, Layer *l, bool input_re
 	
 	bool cut_output = output_map_size > acc->_iobuf._size;
 
+	// weights pinned in the second tier are read from there
+	// and never need to be cut
+	bool pinned = weight_ready && acc->_use_pinned;
+
 	// get the necessary energy for data read from cache
 	// and result write to cache
-	ene = GetOnChipEnergy(acc, l);
-	double calc_time = GetCalcTime(acc, l);
+	if (pinned) {
+		Accelerator pinned_acc = PinnedView(acc);
+		ene = ActivityEnergy(&pinned_acc, act);
+	}
+	else {
+		ene = ActivityEnergy(acc, act);
+	}
+	double calc_time = act._cycle / acc->_mac_freq;
 
 	// in any case choose the data reuse pattern.
 	// Considering the buffer bandwidth limitation, reuse slow buffer
 	// may reduce the background power
 	// otherwise, cutting param should be chosen to optimize the energy
 	double output_trans_time = cut_output ? l->GetOutputMapSize() / acc->WriteMapBw() : 0.0;
-	int input_trans_size;
-	int weight_trans_size;
+	// in datum, the cuts can repeat a transfer past the int range
+	double input_trans_size;
+	double weight_trans_size;
 
 	// case 1: calculate pixel first, reuse weights
 	// then, each feature map will be loaded multiple times
 	// weights are loaded once
 	EnergyModel case1_ene;
-	int cut_channel = CEIL_DIV(weight_size, acc->_weight._size);
-	input_trans_size = input_ready ? 0 : (input_map_size * cut_channel);
+	// a weight buffer used up by pinned weights still streams one datum at a time
+	int cut_channel = pinned ? 1 : MAX(1, CEIL_DIV(weight_size, MAX(1, acc->_weight._size)));
+	input_trans_size = input_ready ? 0 : ((double)input_map_size * cut_channel);
 	weight_trans_size = weight_ready ? 0 : weight_size;
 
-	case1_ene._rd_ddr = acc->_ddr._unit_rd_ene * (input_trans_size + weight_trans_size);
+	ChargeDDR(acc, l, case1_ene, input_trans_size, weight_trans_size, 0);
 	case1_ene._wr_iobuf = input_trans_size * acc->_iobuf._unit_wr_ene;
 	case1_ene._wr_weight = weight_trans_size * acc->_weight._unit_wr_ene;
 
 	double case1_trans_time = output_trans_time + 
 		input_trans_size / acc->ReadMapBw() +
 		weight_trans_size / acc->ReadWeightBw();
-	case1_ene._bg = acc->BackgroundPower() * MAX(case1_trans_time, calc_time) * 1000;
+	case1_ene._time = MAX(case1_trans_time, calc_time);
+	case1_ene._bg += acc->BackgroundPower() * case1_ene._time * 1000;
 
 	// case 2: calculate channel first, reuse feature map
 	// then, each weight will be loaded multiple times
@@ -86,33 +218,32 @@ EnergyModel Optimizer::_optSingleLayer(Accelerator *acc, Layer *l, bool input_re
 	EnergyModel case2_ene;
 	int cut_map = CEIL_DIV(input_map_size, acc->_iobuf._size);
 	input_trans_size = input_ready ? 0 : input_map_size;
-	weight_trans_size = weight_ready ? 0 : (weight_size * cut_map);
+	weight_trans_size = weight_ready ? 0 : ((double)weight_size * cut_map);
 
-	case2_ene._rd_ddr = acc->_ddr._unit_rd_ene * (input_trans_size + weight_trans_size);
+	ChargeDDR(acc, l, case2_ene, input_trans_size, weight_trans_size, 0);
 	case2_ene._wr_iobuf = input_trans_size * acc->_iobuf._unit_wr_ene;
 	case2_ene._wr_weight = weight_trans_size * acc->_weight._unit_wr_ene;
 
 	double case2_trans_time = output_trans_time + 
 		input_map_size / acc->ReadMapBw() +
-		weight_size * cut_map / acc->ReadWeightBw();
-	case2_ene._bg = acc->BackgroundPower() * MAX(case2_trans_time, calc_time) * 1000;
+		(double)weight_size * cut_map / acc->ReadWeightBw();
+	case2_ene._time = MAX(case2_trans_time, calc_time);
+	case2_ene._bg += acc->BackgroundPower() * case2_ene._time * 1000;
 
 	if (case1_ene.Total() < case2_ene.Total()) {
 		ene = ene + case1_ene;
-		//std::cout << "Chose case 1, cut channel = " << cut_channel << std::endl;
-		//std::cout << "data trans time (us):  " << case1_trans_time << std::endl;
-		//std::cout << "calculation time (us): " << calc_time << std::endl;
+		ene.AddDecision(1);
+		PROF_COUNT(PROF_CASE_REUSE_WEIGHT);
 	}
 	else {
 		ene = ene + case2_ene;
-		//std::cout << "Chose case 2, cut map = " << cut_map << std::endl;
-		//std::cout << "data trans time (us):  " << case1_trans_time << std::endl;
-		//std::cout << "calculation time (us): " << calc_time << std::endl;
+		ene.AddDecision(2);
+		PROF_COUNT(PROF_CASE_REUSE_MAP);
 	}
 
 	if (cut_output) {
 		ene._rd_iobuf += l->GetOutputMapSize() *	acc->_iobuf._unit_rd_ene;
-		ene._wr_ddr += l->GetOutputMapSize() * acc->_ddr._unit_wr_ene;
+		ChargeDDR(acc, l, ene, 0, 0, l->GetOutputMapSize());
 	}
 
 	return ene;
@@ -120,67 +251,141 @@ EnergyModel Optimizer::_optSingleLayer(Accelerator *acc, Layer *l, bool input_re
 
 EnergyModel Optimizer::OptSingleLayer(Accelerator *acc, Layer *l, bool input_ready, bool weight_ready)
 {
+	PROF_COUNT(PROF_OPT_SINGLE_LAYER);
 	EnergyModel ene;
-	Layer *ker_layer = new Layer(*l);
-	ker_layer->_input_map_num /= l->_group;
-	ker_layer->_output_map_num /= l->_group;
-	ene = _optSingleLayer(acc, ker_layer, input_ready, weight_ready);
+	Layer ker_layer = _groupLayer(l);
+	ene = _optSingleLayer(acc, &ker_layer, GetActivity(GetActivityFunc(acc), acc, &ker_layer),
+		input_ready, weight_ready);
 	ene = ene * l->_group;
-	delete ker_layer;
 	return ene;
 }
 
-EnergyModel Optimizer::OptNetworkSingle(Accelerator *acc)
+EnergyModel Optimizer::_optLayer(Accelerator *acc, int i, bool input_ready, bool weight_ready)
+{
+	const LayerActivity *act = _findActivity(acc, true);
+	if (act == nullptr) {
+		PROF_COUNT(PROF_ACTIVITY_MISS);
+		return OptSingleLayer(acc, _net[i], input_ready, weight_ready);
+	}
+
+	PROF_COUNT(PROF_OPT_SINGLE_LAYER);
+	PROF_COUNT(PROF_ACTIVITY_HIT);
+	EnergyModel ene;
+	Layer ker_layer = _groupLayer(_net[i]);
+	ene = _optSingleLayer(acc, &ker_layer, act[i], input_ready, weight_ready);
+	ene = ene * _net[i]->_group;
+	return ene;
+}
+
+Layer Optimizer::_groupLayer(Layer *l)
 {
+	Layer ker_layer = *l;
+	ker_layer._input_map_num /= l->_group;
+	ker_layer._output_map_num /= l->_group;
+	ker_layer._group = 1;
+	return ker_layer;
+}
+
+EnergyModel Optimizer::OptNetworkSingle(Accelerator *acc, EnergyModel *layer_ene)
+{
+	PROF_SCOPE("OptNetworkSingle");
 	EnergyModel tol_ene, cur_ene;
 	for (int i = 0; i < _net.size(); i++) {
-		//std::cout << "Layer " << i << std::endl;
 		bool input_ready = (i > 0) && (_net[i]->GetInputMapSize() < acc->_iobuf._size);
-		cur_ene = OptSingleLayer(acc, _net[i], input_ready, false);		
-		//std::cout << cur_ene << std::endl;
+		cur_ene = _optLayer(acc, i, input_ready, false);		
 		tol_ene = tol_ene + cur_ene;
+		tol_ene.AddSchedule(cur_ene._schedule);
+		if (layer_ene != nullptr) {
+			layer_ene[i] = cur_ene;
+		}
 	}
 	// write result to ddr finally
-	tol_ene._rd_iobuf += _net[_net.size() - 1]->GetOutputMapSize() * acc->_iobuf._unit_rd_ene;
-	tol_ene._wr_ddr += _net[_net.size() - 1]->GetOutputMapSize() * acc->_ddr._unit_wr_ene;
+	Layer *last = _net[_net.size() - 1];
+	EnergyModel write_ene;
+	write_ene._rd_iobuf = last->GetOutputMapSize() * acc->_iobuf._unit_rd_ene;
+	ChargeDDR(acc, last, write_ene, 0, 0, last->GetOutputMapSize());
+	tol_ene = tol_ene + write_ene;
+	if (layer_ene != nullptr) {
+		layer_ene[_net.size() - 1] = layer_ene[_net.size() - 1] + write_ene;
+	}
 	return tol_ene;
 }
 
 // optimize over a network consider cross layer schedule
-EnergyModel Optimizer::OptNetworkCrossLayer(Accelerator *acc, bool *weight_ready)
+EnergyModel Optimizer::OptNetworkCrossLayer(Accelerator *acc, bool *weight_ready,
+	EnergyModel *layer_ene)
 {
 	int layer_num = _net.size();
-	EnergyModel *opt_ene = new EnergyModel[layer_num];
-	EnergyModel *on_chip_ene = new EnergyModel[layer_num];
-	double *calc_time = new double[layer_num];
-	bool *fits_in_buf = new bool[layer_num];
+	OptScratch *scratch = OptScratch::Get();
+	scratch->ReserveCross(layer_num);
+	EnergyModel *opt_ene = scratch->_opt_ene;
+	EnergyModel *on_chip_ene = scratch->_on_chip_ene;
+	double *calc_time = scratch->_calc_time;
+	bool *fits_in_buf = scratch->_fits_in_buf;
 	// cut[i]: for layer 0-i, the last group of layer is
 	// cut[i]~j
-	int *cut = new int[layer_num];
-	bool *input_ready = new bool[layer_num + 1];
+	int *cut = scratch->_cut;
+	bool *input_ready = scratch->_input_ready;
+
+	// an edited network reuses the DP prefix of the previous run,
+	// and a pinning that of the pinnings tried before
+	unsigned long long acc_hash = 0;
+	int found = 0;
+	if (_inc != nullptr) {
+		acc_hash = IncrementalCache::HashAccelerator(acc);
+		found = _inc->FindPrefix(acc_hash, weight_ready, opt_ene, cut, input_ready);
+	}
+
+	// the merges of a reused prefix stop where the weights exceed
+	// the buffer, the layers before are not reached again
+	int first = 0;
+	if (found > 0 && layer_ene == nullptr) {
+		first = found;
+		int tol_weight_size = (found < layer_num && !weight_ready[found]) ?
+			_net[found]->GetWeightSize() : 0;
+		while (first > 0 && found < layer_num) {
+			tol_weight_size += (!weight_ready[first - 1]) ? _net[first - 1]->GetWeightSize() : 0;
+			if (tol_weight_size > acc->_weight._size) {
+				break;
+			}
+			first--;
+		}
+	}
 
 	// calculate the necessary on-chip energy for all the layers first
-	for (int i = 0; i < layer_num; i++) {
-		on_chip_ene[i] = GetOnChipEnergy(acc, _net[i]);
-		calc_time[i] = GetCalcTime(acc, _net[i]);
+	Accelerator pinned_acc = PinnedView(acc);
+	const LayerActivity *act = _findActivity(acc, false);
+	ActivityFunc func = (act != nullptr) ? nullptr : GetActivityFunc(acc);
+	for (int i = first; i < layer_num; i++) {
+		LayerActivity cur_act = (act != nullptr) ? act[i] : GetActivity(func, acc, _net[i]);
+		on_chip_ene[i] = ActivityEnergy(
+			(weight_ready[i] && acc->_use_pinned) ? &pinned_acc : acc, cur_act);
+		calc_time[i] = cur_act._cycle / acc->_mac_freq;
 		fits_in_buf[i] = _net[i]->GetInputMapSize() < acc->_iobuf._size;
 	}
 
 	// initialize the first layer
-	opt_ene[0] = OptSingleLayer(acc, _net[0], false, weight_ready[0]);
-	cut[0] = 0;
-	input_ready[0] = false;
-	input_ready[1] = _net[0]->GetOutputMapSize() < acc->_iobuf._size;
+	int start = found;
+	if (start == 0) {
+		opt_ene[0] = _optLayer(acc, 0, false, weight_ready[0]);
+		cut[0] = 0;
+		input_ready[0] = false;
+		input_ready[1] = _net[0]->GetOutputMapSize() < acc->_iobuf._size;
+		start = 1;
+	}
 	
-	for (int i = 1; i < layer_num; i++) {
+	for (int i = start; i < layer_num; i++) {
 		// first try no merge
-		opt_ene[i] = OptSingleLayer(acc, _net[i], input_ready[i], weight_ready[i]) + opt_ene[i-1];
+		opt_ene[i] = _optLayer(acc, i, input_ready[i], weight_ready[i]) + opt_ene[i-1];
+		opt_ene[i].AddSchedule(opt_ene[i-1]._schedule);
 		cut[i] = i;
 		input_ready[i + 1] = _net[i]->GetOutputMapSize() < acc->_iobuf._size;
 		int tol_weight_size = (!weight_ready[i]) ? _net[i]->GetWeightSize() : 0;
 
 		// try to merge layer j to i
 		EnergyModel merge_calc_ene = on_chip_ene[i];
+		EnergyModel merge_weight_ene;
+		ChargeDDR(acc, _net[i], merge_weight_ene, 0, tol_weight_size, 0);
 		double merge_calc_time = calc_time[i];
 		double merge_data_trans_time = _net[i]->GetOutputMapSize() / acc->WriteMapBw();
 		merge_data_trans_time += tol_weight_size / acc->ReadMapBw();
@@ -188,10 +393,12 @@ EnergyModel Optimizer::OptNetworkCrossLayer(Accelerator *acc, bool *weight_ready
 		bool write_output = (i == (layer_num - 1)) || (!fits_in_buf[i + 1]);
 		for (int j = i - 1; j >= 0; j--) {
 			// merge layer j to layer i
+			PROF_COUNT(PROF_DP_ITER);
 
 			// if the total size of weight exceeds the size of
 			// weights buffer, then we do not try to merge them
-			tol_weight_size += (!weight_ready[j]) ? _net[j]->GetWeightSize() : 0;		
+			int weight_size = (!weight_ready[j]) ? _net[j]->GetWeightSize() : 0;
+			tol_weight_size += weight_size;
 			if (tol_weight_size > acc->_weight._size) {
 				break;
 			}
@@ -208,8 +415,7 @@ EnergyModel Optimizer::OptNetworkCrossLayer(Accelerator *acc, bool *weight_ready
 			
 			// then add the feature map input energy if needed
 			if (!input_ready[j]) {
-				cur_ene._rd_ddr += _net[j]->GetInputMapSize() *
-					acc->_ddr._unit_rd_ene;
+				ChargeDDR(acc, _net[j], cur_ene, _net[j]->GetInputMapSize(), 0, 0);
 				cur_ene._wr_iobuf += _net[j]->GetInputMapSize() *
 					acc->_iobuf._unit_rd_ene;	
 			}
@@ -219,7 +425,8 @@ EnergyModel Optimizer::OptNetworkCrossLayer(Accelerator *acc, bool *weight_ready
 			cur_ene = cur_ene + merge_calc_ene;
 
 			// add weight transfer energy
-			cur_ene._rd_ddr += tol_weight_size * acc->_ddr._unit_rd_ene;
+			ChargeDDR(acc, _net[j], merge_weight_ene, 0, weight_size, 0);
+			cur_ene = cur_ene + merge_weight_ene;
 			cur_ene._wr_weight += tol_weight_size * acc->_weight._unit_wr_ene;
 
 			// add background energy
@@ -229,11 +436,16 @@ EnergyModel Optimizer::OptNetworkCrossLayer(Accelerator *acc, bool *weight_ready
 				(_net[j]->GetInputMapSize() / acc->ReadMapBw()) : 0);
 			double time = MAX(merge_calc_time, data_trans_time);
 			cur_ene._bg += time * acc->BackgroundPower() * 1000;
+			cur_ene._time += time;
 
 			write_output = write_output || (!fits_in_buf[j + 1]);
 
 			// judge if this is a better choice
 			if (cur_ene.Total() < opt_ene[i].Total()) {
+				if (j > 0) {
+					cur_ene.AddSchedule(opt_ene[j - 1]._schedule);
+				}
+				cur_ene.AddDecision(((unsigned long long)i << 32) | j);
 				cut[i] = j;
 				opt_ene[i] = cur_ene;
 				input_ready[i + 1] = !write_output;
@@ -241,67 +453,163 @@ EnergyModel Optimizer::OptNetworkCrossLayer(Accelerator *acc, bool *weight_ready
 		}
 	}
 
-	/*
-	for (int i = 0; i < layer_num; i++) {
-		std::cout << "Layer " << i << ": " << cut[i] << "\t" << input_ready[i] << std::endl;
-		std::cout << opt_ene[i] << std::endl;
-	}*/
+	if (_inc != nullptr) {
+		_inc->StoreState(acc_hash, weight_ready, found, opt_ene, cut, input_ready);
+	}
 
 	// write the final result back to ddr
 	EnergyModel res = opt_ene[layer_num - 1];
-	res._rd_iobuf += _net[layer_num - 1]->GetOutputMapSize() * acc->_iobuf._unit_rd_ene;
-	res._wr_ddr += _net[layer_num - 1]->GetOutputMapSize() * acc->_ddr._unit_wr_ene;
+	Layer *last = _net[layer_num - 1];
+	res._rd_iobuf += last->GetOutputMapSize() * acc->_iobuf._unit_rd_ene;
+	ChargeDDR(acc, last, res, 0, 0, last->GetOutputMapSize());
+	if (layer_ene != nullptr) {
+		_crossLayerEnergy(acc, weight_ready, res, layer_ene);
+	}
+	return res;
+}
 
-	delete[] opt_ene;
-	delete[] cut;
-	delete[] input_ready;
-	delete[] on_chip_ene;
-	delete[] calc_time;
-	delete[] fits_in_buf;
+void Optimizer::_crossLayerEnergy(Accelerator *acc, bool *weight_ready, EnergyModel &res,
+	EnergyModel *layer_ene)
+{
+	int layer_num = _net.size();
+	OptScratch *scratch = OptScratch::Get();
+	EnergyModel *opt_ene = scratch->_opt_ene;
+	EnergyModel *on_chip_ene = scratch->_on_chip_ene;
+	double *calc_time = scratch->_calc_time;
+	int *cut = scratch->_cut;
+
+	// walk the merged groups back from the last layer
+	for (int i = layer_num - 1; i >= 0; i = cut[i] - 1) {
+		int j = cut[i];
+		if (j == i) {
+			layer_ene[i] = _optLayer(acc, i, scratch->_input_ready[i], weight_ready[i]);
+			continue;
+		}
 
-	return res;
+		EnergyModel group_ene = opt_ene[i];
+		if (j > 0) {
+			group_ene = group_ene - opt_ene[j - 1];
+		}
+		EnergyModel shared_ene = group_ene;
+		double group_time = 0;
+		for (int k = j; k <= i; k++) {
+			shared_ene = shared_ene - on_chip_ene[k];
+			group_time += calc_time[k];
+		}
+		EnergyModel merge;
+		merge.AddDecision(((unsigned long long)i << 32) | j);
+		for (int k = j; k <= i; k++) {
+			double share = (group_time > 0) ? calc_time[k] / group_time : 1.0 / (i - j + 1);
+			layer_ene[k] = shared_ene * share;
+			layer_ene[k] = layer_ene[k] + on_chip_ene[k];
+			layer_ene[k]._schedule = merge._schedule;
+		}
+	}
+
+	// the result write back
+	EnergyModel write_ene = res - opt_ene[layer_num - 1];
+	layer_ene[layer_num - 1] = layer_ene[layer_num - 1] + write_ene;
 }
 
 // optimize the schedule by set weights fixed in cache
-EnergyModel Optimizer::OptNetworkFixedWeights(Accelerator *acc)
+EnergyModel Optimizer::OptNetworkFixedWeights(Accelerator *acc, EnergyModel *layer_ene)
 {
+	PROF_SCOPE("OptNetworkFixedWeights");
 	int tol_weight_size = 0;
 	int layer_num = _net.size();
 
-	for each (Layer *l in _net) {
+	for (Layer *l : _net) {
 		tol_weight_size += l->GetWeightSize();
 	}
 
-	bool *weight_ready = new bool[layer_num];
+	OptScratch *scratch = OptScratch::Get();
+	scratch->ReservePin(layer_num);
+	bool *weight_ready = scratch->_weight_ready;
 
 	// if all the weights fits in the cache, then fits them in
-	if (tol_weight_size <= acc->_weight._size) {
-		std::cout << "Put all the weights in cache." << std::endl;
+	if (tol_weight_size <= acc->PinBuffer()._size) {
+		if (_verbose) {
+			std::cout << "Put all the weights in cache." << std::endl;
+		}
 		for (int i = 0; i < layer_num; i++) {
 			weight_ready[i] = true;
 		}
-		return OptNetworkCrossLayer(acc, weight_ready);
+		EnergyModel res = OptNetworkCrossLayer(acc, weight_ready, layer_ene);
+		res.AddDecision(PinnedMask(weight_ready));
+		return res;
 	}
 
-	// otherwise, search a result in a recursion mode
-	EnergyModel res = OptNetworkFixedWeightsSub(acc, 0, weight_ready);
-	for (int i = 0; i < layer_num; i++) {
-		//std::cout << weight_ready[i] << std::endl;
+	// otherwise, search a result in a recursion mode, which doubles
+	// with every layer that could be pinned, all but the last
+	int candidate_num = 0;
+	for (int l = 0; l < layer_num - 1; l++) {
+		int weight_size = _net[l]->GetWeightSize();
+		if (weight_size > 0 && weight_size <= acc->PinBuffer()._size) {
+			candidate_num++;
+		}
+	}
+	EnergyModel res = (candidate_num > _max_pin_search) ?
+		_pinGreedy(acc, weight_ready) : OptNetworkFixedWeightsSub(acc, 0, weight_ready);
+
+	// the layer energy of the chosen pinning, whose weights
+	// take their space from the pin buffer
+	if (layer_ene != nullptr) {
+		Accelerator pin_acc = *acc;
+		for (int i = 0; i < layer_num; i++) {
+			if (weight_ready[i]) {
+				pin_acc.PinBuffer()._size -= _net[i]->GetWeightSize();
+			}
+		}
+		OptNetworkCrossLayer(&pin_acc, weight_ready, layer_ene);
 	}
-	delete[] weight_ready;
 	return res;
 }
 
+EnergyModel Optimizer::_pinGreedy(Accelerator *acc, bool *weight_ready)
+{
+	int layer_num = _net.size();
+	for (int i = 0; i < layer_num; i++) {
+		weight_ready[i] = false;
+	}
+	Accelerator cur_acc = *acc;
+	EnergyModel best = OptNetworkCrossLayer(&cur_acc, weight_ready);
+
+	// the last layer is never pinned, as in OptNetworkFixedWeightsSub
+	for (int l = 0; l < layer_num - 1; l++) {
+		int weight_size = _net[l]->GetWeightSize();
+		if (weight_size == 0 || weight_size > cur_acc.PinBuffer()._size) {
+			continue;
+		}
+		PROF_COUNT(PROF_PIN_LEAF);
+		Accelerator acc2 = cur_acc;
+		acc2.PinBuffer()._size -= weight_size;
+		weight_ready[l] = true;
+		EnergyModel ene = OptNetworkCrossLayer(&acc2, weight_ready);
+		if (ene.Total() < best.Total()) {
+			best = ene;
+			cur_acc = acc2;
+		}
+		else {
+			weight_ready[l] = false;
+		}
+	}
+	best.AddDecision(PinnedMask(weight_ready));
+	return best;
+}
+
 EnergyModel Optimizer::OptNetworkFixedWeightsSub(Accelerator *acc, int l, bool *weight_ready)
 {
 	if (l >= (_net.size() - 1)) {
+		PROF_COUNT(PROF_PIN_LEAF);
 		weight_ready[_net.size() - 1] = false;
-		return OptNetworkCrossLayer(acc, weight_ready);
+		EnergyModel ene = OptNetworkCrossLayer(acc, weight_ready);
+		ene.AddDecision(PinnedMask(weight_ready));
+		return ene;
 	}
 
-	// if the rest weights are larger than the RAM
-	// then skip this layer
-	if (_net[l]->GetWeightSize() > acc->_weight._size) {
+	// if the rest weights are larger than the RAM, or the layer
+	// has no weights, then skip this layer
+	if (_net[l]->GetWeightSize() > acc->PinBuffer()._size || _net[l]->GetWeightSize() == 0) {
 		weight_ready[l] = false;
 		return OptNetworkFixedWeightsSub(acc, l + 1, weight_ready);
 	}
@@ -311,15 +619,20 @@ EnergyModel Optimizer::OptNetworkFixedWeightsSub(Accelerator *acc, int l, bool *
 	EnergyModel ene2;
 	EnergyModel ene;
 
-	bool *weight_ready1 = new bool[_net.size()];
-	bool *weight_ready2 = new bool[_net.size()];
+	// the arrays of this recursion level in the scratch
+	OptScratch *scratch = OptScratch::Get();
+	scratch->ReservePin(_net.size());
+	bool *weight_ready1 = scratch->_weight_ready + (2 * l + 1) * _net.size();
+	bool *weight_ready2 = weight_ready1 + _net.size();
 	memcpy(weight_ready1, weight_ready, _net.size());
 	memcpy(weight_ready2, weight_ready, _net.size());
 	weight_ready1[l] = false;
 	weight_ready2[l] = true;
 
+	// pinned weights take space from the weight buffer, or
+	// from the second tier if there is one
 	Accelerator acc2 = *acc;
-	acc2._weight._size -= _net[l]->GetWeightSize();
+	acc2.PinBuffer()._size -= _net[l]->GetWeightSize();
 
 	ene1 = OptNetworkFixedWeightsSub(acc, l + 1, weight_ready1);
 	ene2 = OptNetworkFixedWeightsSub(&acc2, l + 1, weight_ready2);
@@ -332,64 +645,157 @@ EnergyModel Optimizer::OptNetworkFixedWeightsSub(Accelerator *acc, int l, bool *
 		memcpy(weight_ready, weight_ready2, _net.size());
 		ene = ene2;
 	}
-
-	delete[] weight_ready1;
-	delete[] weight_ready2;
 	return ene;
 }
 
 
+// the pinned layers as a schedule decision
+unsigned long long Optimizer::PinnedMask(bool *weight_ready)
+{
+	unsigned long long mask = 0;
+	for (int i = 0; i < _net.size(); i++) {
+		mask = (mask << 1) | (weight_ready[i] ? 1 : 0);
+	}
+	return mask | (1ULL << 63);
+}
+
+// charge the DDR traffic of one schedule phase of layer l.
+// Feature maps are streamed sequentially and pay one row activation
+// per row, weights are fetched as kernel tiles of the MAC array, so
+// short tiles open a new row more often.
+void Optimizer::ChargeDDR(Accelerator *acc, Layer *l, EnergyModel &ene,
+	double map_rd, double weight_rd, double map_wr)
+{
+	ene._rd_ddr += (map_rd + weight_rd) * acc->_ddr._unit_rd_ene;
+	ene._wr_ddr += map_wr * acc->_ddr._unit_wr_ene;
+
+	double busy_time = (map_rd + weight_rd) / acc->_ddr._rd_bw +
+		map_wr / acc->_ddr._wr_bw;
+	ene._ddr_time += busy_time;
+
+	// the flat model already includes sequential activations
+	// in the unit energy
+	double row_size = acc->_ddr_row._row_size;
+	if (row_size <= 0) {
+		return;
+	}
+	double tile_run = l->_kernel_x * l->_kernel_y * acc->_input_map_p;
+	if (tile_run < row_size) {
+		ene._rd_ddr += weight_rd * acc->_ddr_row._act_ene *
+			(1 / tile_run - 1 / row_size);
+	}
+	ene._bg += acc->_ddr_row._active_pwr * busy_time * 1000;
+	return;
+}
+
+// the accelerator seen by a layer whose weights are pinned
+// in the second weight tier
+Accelerator Optimizer::PinnedView(Accelerator *acc)
+{
+	Accelerator view = *acc;
+	view._weight._unit_rd_ene = acc->_pinned._unit_rd_ene;
+	view._weight._rd_bw = acc->_pinned._rd_bw;
+	return view;
+}
+
 // calculate the energy for data read from cache 
 // and result write to cache
 EnergyModel Optimizer::GetOnChipEnergy(Accelerator *acc, Layer *l)
 {
-	EnergyModel ene;
-	// get energy for data read from input buffer
-	double input_energy_pJ;
-	if (l->_kernel_str == 1 && acc->_acc_buf._size == 1) {
-		ene._rd_iobuf =
-			l->_input_map_y * CEIL_DIV(l->_input_map_x, acc->_pixel_p) *// output pixel group number
-			(l->_kernel_x + acc->_pixel_p - 1) * l->_kernel_y *			// input pixel group size
-			acc->_iobuf._unit_rd_ene;									// unit energy
+	return ActivityEnergy(acc, GetActivity(acc, l));
+}
+
+double Optimizer::GetCalcTime(Accelerator *acc, Layer *l)
+{
+	return GetActivity(acc, l)._cycle / acc->_mac_freq;
+}
+
+LayerActivity Optimizer::GetActivity(Accelerator *acc, Layer *l)
+{
+	return GetActivity(FindActivityFunc(acc), acc, l);
+}
+
+LayerActivity Optimizer::GetActivity(ActivityFunc func, Accelerator *acc, Layer *l)
+{
+	if (l->_group <= 1) {
+		return func(acc, l);
 	}
-	else {
-		ene._rd_iobuf = (l->_input_map_x / l->_kernel_str) *
-			(l->_input_map_y / l->_kernel_str) *
-			(l->_kernel_x * l->_kernel_y) *
-			acc->_iobuf._unit_rd_ene;
-	}	
-
-	// get energy for result write to output buffer
-	ene._wr_iobuf =
-		l->GetOutputMapSize() * acc->_iobuf._unit_wr_ene;
-
-	// get energy for weight read from weight buffer
-	int output_map_x = l->_input_map_x / l->_kernel_str;
-	int output_map_y = l->_input_map_y / l->_kernel_str;
-	ene._rd_weight = 
-		l->GetWeightSize() * 
-		CEIL_DIV(output_map_x * CEIL_DIV(output_map_y, acc->_pixel_p), acc->_acc_buf._size) *
-		acc->_weight._unit_rd_ene;
-
-	// get calculation energy
-	ene._calc = l->GetMacNum() * acc->_mac_ene;
-	ene._calc += (output_map_x * output_map_y * l->_output_map_num) *
-		(CEIL_DIV(l->_input_map_num, acc->_input_map_p) * l->_kernel_x * l->_kernel_y - 1) *
-		(acc->_acc_buf._unit_rd_ene + acc->_acc_buf._unit_wr_ene);
 
+	// the groups run one after another on the array
+	Layer ker_layer = _groupLayer(l);
+	LayerActivity act = func(acc, &ker_layer);
+	act._rd_iobuf *= l->_group;
+	act._wr_iobuf *= l->_group;
+	act._rd_weight *= l->_group;
+	act._mac *= l->_group;
+	act._acc *= l->_group;
+	act._cycle *= l->_group;
+	return act;
+}
+
+EnergyModel Optimizer::ActivityEnergy(Accelerator *acc, const LayerActivity &act)
+{
+	EnergyModel ene;
+	ene._rd_iobuf = act._rd_iobuf * acc->_iobuf._unit_rd_ene;
+	ene._wr_iobuf = act._wr_iobuf * acc->_iobuf._unit_wr_ene;
+	ene._rd_weight = act._rd_weight * acc->_weight._unit_rd_ene;
+	ene._calc = act._mac * acc->_mac_ene;
+	ene._calc += act._acc * (acc->_acc_buf._unit_rd_ene + acc->_acc_buf._unit_wr_ene);
 	return ene;
 }
 
-double Optimizer::GetCalcTime(Accelerator *acc, Layer *l)
+void Optimizer::Precompute(Accelerator *acc)
 {
-	double cycle_num;
-	cycle_num = (l->_input_map_y / l->_kernel_str) *
-		CEIL_DIV(l->_input_map_x / l->_kernel_str, acc->_pixel_p);
-	cycle_num *= CEIL_DIV(l->_input_map_num, acc->_input_map_p) *
-		CEIL_DIV(l->_output_map_num, acc->_output_map_p);
-	cycle_num *= l->_kernel_x * l->_kernel_y;
+	ArrayShape shape(acc);
+	for (int s = 0; s < _shapes.size(); s++) {
+		if (_shapes[s] == shape) {
+			return;
+		}
+	}
+
+	shape._func = FindActivityFunc(acc);
+	std::vector<LayerActivity> act(_net.size());
+	std::vector<LayerActivity> group_act(_net.size());
+	for (int i = 0; i < _net.size(); i++) {
+		Layer ker_layer = _groupLayer(_net[i]);
+		act[i] = GetActivity(shape._func, acc, _net[i]);
+		group_act[i] = GetActivity(shape._func, acc, &ker_layer);
+	}
+	_shapes.push_back(shape);
+	_activity.push_back(act);
+	_group_activity.push_back(group_act);
+}
+
+void Optimizer::ClearPrecompute()
+{
+	_shapes.clear();
+	_activity.clear();
+	_group_activity.clear();
+}
 
-	return cycle_num / acc->_mac_freq;
+const LayerActivity *Optimizer::_findActivity(Accelerator *acc, bool group)
+{
+	if (_shapes.empty()) {
+		return nullptr;
+	}
+	ArrayShape shape(acc);
+	for (int s = 0; s < _shapes.size(); s++) {
+		if (_shapes[s] == shape) {
+			return group ? _group_activity[s].data() : _activity[s].data();
+		}
+	}
+	return nullptr;
+}
+
+ActivityFunc Optimizer::GetActivityFunc(Accelerator *acc)
+{
+	ArrayShape shape(acc);
+	for (int s = 0; s < _shapes.size(); s++) {
+		if (_shapes[s] == shape) {
+			return _shapes[s]._func;
+		}
+	}
+	return FindActivityFunc(acc);
 }
 
 // Integer variable minizer by direct search
@@ -411,7 +817,7 @@ double Optimizer::IntMinimizer(int min, int max, int &min_var,
 double Optimizer::EnergyEfficiency(EnergyModel ene)
 {
 	double mac_num = 0;
-	for each (Layer *l in _net) {
+	for (Layer *l : _net) {
 		mac_num += l->GetMacNum();
 	}
 	return ene.Total() / mac_num;
@@ -5,37 +5,170 @@
 #include <functional>
 #include <string>
 
+// work of a layer that only depends on the MAC array shape,
+// the on-chip energy is this activity times the unit energies
+class LayerActivity {
+public:
+	double _rd_iobuf;	// datum read from the input buffer
+	double _wr_iobuf;	// datum written to the output buffer
+	double _rd_weight;	// datum read from the weight buffer
+	double _mac;		// MAC operations
+	double _acc;		// accumulator fifo read-write pairs
+	double _cycle;		// MAC array cycles
+};
+
+// layer activity evaluator for one MAC array shape, see shape_eval.h
+typedef LayerActivity (*ActivityFunc)(Accelerator *acc, Layer *l);
+
+// the part of an accelerator the layer activity depends on
+class ArrayShape {
+public:
+	int _pixel_p;
+	int _input_map_p;
+	int _output_map_p;
+	int _acc_size;
+
+	// evaluator of the shape, set by Optimizer::Precompute
+	ActivityFunc _func;
+
+public:
+	ArrayShape(Accelerator *acc)
+	{
+		_pixel_p = acc->_pixel_p;
+		_input_map_p = acc->_input_map_p;
+		_output_map_p = acc->_output_map_p;
+		_acc_size = acc->_acc_buf._size;
+		_func = nullptr;
+	}
+
+	bool operator==(const ArrayShape &b) const
+	{
+		return _pixel_p == b._pixel_p && _input_map_p == b._input_map_p &&
+			_output_map_p == b._output_map_p && _acc_size == b._acc_size;
+	}
+};
+
+// working arrays of the network optimizations, kept per thread
+// so repeated optimizations do not allocate
+class OptScratch {
+public:
+	// cross layer dynamic programming, one entry per layer
+	int _cross_size;
+	EnergyModel *_opt_ene;
+	EnergyModel *_on_chip_ene;
+	double *_calc_time;
+	bool *_fits_in_buf;
+	int *_cut;
+	bool *_input_ready;
+
+	// pinning recursion, one weight_ready array for the root
+	// and two per recursion level
+	int _pin_size;
+	bool *_weight_ready;
+
+public:
+	OptScratch();
+	~OptScratch();
+
+	void ReserveCross(int layer_num);
+	void ReservePin(int layer_num);
+
+	// scratch of the calling thread
+	static OptScratch *Get();
+};
+
+class IncrementalCache;
+
 class Optimizer {
 public:
 	Net _net;
 
+	// report the notable decisions on stdout
+	bool _verbose;
+
+	// the pinning search tries every subset of up to this many layers,
+	// deeper networks are pinned greedily
+	int _max_pin_search;
+
+	// results of the previous run of an edited network, see incremental.h
+	IncrementalCache *_inc;
+
+	// layer activity precomputed per array shape, for the whole
+	// layer and for one of its groups
+	std::vector<ArrayShape> _shapes;
+	std::vector<std::vector<LayerActivity> > _activity;
+	std::vector<std::vector<LayerActivity> > _group_activity;
+
 public:
+	Optimizer();
 	~Optimizer();
 
-	// load a network from file
-	void LoadNetFromFile(const std::string fn);
+	// load a network from file, false if it cannot be read
+	bool LoadNetFromFile(const std::string fn);
+
+	// load a network from a stream in the network file format
+	bool LoadNet(std::istream &is);
+
+	// precompute the layer activity for the array shape of acc,
+	// later optimizations on the same shape reuse it
+	void Precompute(Accelerator *acc);
+
+	void ClearPrecompute();
 
 	// optimize the schedule of a single layer to minimize energy
 	// the optimized energy is returned
 	EnergyModel OptSingleLayer(Accelerator *acc, Layer *l, bool input_ready, bool weight_ready);
 
+	// The network optimizations below also give the energy of each layer
+	// under the chosen schedule in layer_ene if it is not nullptr. The
+	// result write back goes to the last layer, and the DDR, buffer write
+	// and background energy and the time of merged layers are shared in
+	// proportion to their calculation time. The schedule id of a layer
+	// is that of its own decisions, or of the merge it is part of.
+
 	// optimize the network with each layer considered independently
-	EnergyModel OptNetworkSingle(Accelerator *acc);
+	EnergyModel OptNetworkSingle(Accelerator *acc, EnergyModel *layer_ene = nullptr);
 
 	// optimize over a network consider cross layer schedule
-	EnergyModel OptNetworkCrossLayer(Accelerator *acc, bool *weight_ready);
+	EnergyModel OptNetworkCrossLayer(Accelerator *acc, bool *weight_ready,
+		EnergyModel *layer_ene = nullptr);
 
 	// optimize the schedule by set weights fixed in cache
-	EnergyModel OptNetworkFixedWeights(Accelerator *acc);
+	EnergyModel OptNetworkFixedWeights(Accelerator *acc, EnergyModel *layer_ene = nullptr);
 
 	EnergyModel OptNetworkFixedWeightsSub(Accelerator *acc, int l, bool *weight_ready);
 
 	// optimize the accelerator
 
+	// the pinned layers as a schedule decision
+	unsigned long long PinnedMask(bool *weight_ready);
+
+	// charge the DDR traffic of one schedule phase, the row
+	// activations depend on the access pattern
+	static void ChargeDDR(Accelerator *acc, Layer *l, EnergyModel &ene,
+		double map_rd, double weight_rd, double map_wr);
+
+	// the accelerator seen by a layer whose weights are pinned
+	// in the second weight tier
+	static Accelerator PinnedView(Accelerator *acc);
+
 	// calculate the energy for data read from cache 
 	// and result write to cache
 	static EnergyModel GetOnChipEnergy(Accelerator *acc, Layer *l);
 
+	// count the buffer accesses, MAC operations and cycles of a layer
+	static LayerActivity GetActivity(Accelerator *acc, Layer *l);
+
+	// the same with the evaluator of the array shape of acc
+	static LayerActivity GetActivity(ActivityFunc func, Accelerator *acc, Layer *l);
+
+	// evaluator of the array shape of acc, the one resolved by
+	// Precompute if the shape was precomputed
+	ActivityFunc GetActivityFunc(Accelerator *acc);
+
+	// on-chip energy of a layer activity
+	static EnergyModel ActivityEnergy(Accelerator *acc, const LayerActivity &act);
+
 	// get the time for calculation of a certain layer
 	static double GetCalcTime(Accelerator *acc, Layer *l);
 
@@ -47,5 +180,25 @@ public:
 	double EnergyEfficiency(EnergyModel ene);
 
 private:
-	EnergyModel _optSingleLayer(Accelerator *acc, Layer *l, bool input_ready, bool weight_ready);
+	EnergyModel _optSingleLayer(Accelerator *acc, Layer *l, const LayerActivity &act,
+		bool input_ready, bool weight_ready);
+
+	// OptSingleLayer on layer i of the network
+	EnergyModel _optLayer(Accelerator *acc, int i, bool input_ready, bool weight_ready);
+
+	// precomputed activity table for the shape of acc, nullptr if none
+	const LayerActivity *_findActivity(Accelerator *acc, bool group);
+
+	// one group of a layer
+	static Layer _groupLayer(Layer *l);
+
+	bool _loadExtendedNet(std::istream &is);
+
+	// the layer energy of the cross layer schedule in the scratch
+	void _crossLayerEnergy(Accelerator *acc, bool *weight_ready, EnergyModel &res,
+		EnergyModel *layer_ene);
+
+	// pin layers one by one in network order, keeping a layer pinned
+	// if it lowers the energy
+	EnergyModel _pinGreedy(Accelerator *acc, bool *weight_ready);
 };
@@ -0,0 +1,165 @@
+#include "profiler.h"
+#include <fstream>
+#include <iomanip>
+#include <map>
+
+bool Profiler::_enabled = false;
+std::mutex Profiler::_mutex;
+std::vector<ProfSlot *> Profiler::_slots;
+std::chrono::steady_clock::time_point Profiler::_start = std::chrono::steady_clock::now();
+
+ProfSlotHolder::~ProfSlotHolder()
+{
+	if (_slot != nullptr) {
+		Profiler::Release(_slot);
+	}
+}
+
+ProfSlot *Profiler::Register()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	for (int i = 0; i < _slots.size(); i++) {
+		if (_slots[i]->_free) {
+			_slots[i]->_free = false;
+			return _slots[i];
+		}
+	}
+
+	// slots live until the end of the program, so the counters
+	// of finished threads can still be merged
+	ProfSlot *slot = new ProfSlot;
+	slot->_tid = _slots.size();
+	slot->_free = false;
+	for (int c = 0; c < PROF_COUNTER_NUM; c++) {
+		slot->_count[c] = 0;
+	}
+	_slots.push_back(slot);
+	return slot;
+}
+
+void Profiler::Release(ProfSlot *slot)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	slot->_free = true;
+}
+
+double Profiler::Now()
+{
+	std::chrono::duration<double, std::micro> t = std::chrono::steady_clock::now() - _start;
+	return t.count();
+}
+
+void Profiler::Reset()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	for (int i = 0; i < _slots.size(); i++) {
+		for (int c = 0; c < PROF_COUNTER_NUM; c++) {
+			_slots[i]->_count[c] = 0;
+		}
+		_slots[i]->_events.clear();
+	}
+	_start = std::chrono::steady_clock::now();
+}
+
+const char *Profiler::CounterName(int c)
+{
+	static const char *names[PROF_COUNTER_NUM] = {
+		"opt_single_layer",
+		"case_reuse_weight",
+		"case_reuse_map",
+		"dp_iter",
+		"pin_leaf",
+		"activity_hit",
+		"activity_miss",
+		"design_dup",
+		"design_eval",
+		"cross_cache_hit",
+		"cross_cache_miss",
+	};
+	return names[c];
+}
+
+// write the counters of one slot, or the sum over all slots
+static void WriteCounters(std::ostream &os, long long *count)
+{
+	os << "{";
+	for (int c = 0; c < PROF_COUNTER_NUM; c++) {
+		os << (c ? ", " : "") << "\"" << Profiler::CounterName(c) << "\": " << count[c];
+	}
+	os << "}";
+}
+
+static void WritePhases(std::ostream &os, std::map<std::string, double> &phase)
+{
+	os << "{";
+	bool first = true;
+	for (auto it = phase.begin(); it != phase.end(); it++) {
+		os << (first ? "" : ", ") << "\"" << it->first << "\": " << it->second;
+		first = false;
+	}
+	os << "}";
+}
+
+void Profiler::WriteJSON(const std::string fn)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	std::ofstream os(fn, std::ios::out);
+	// times in us to the ns, the default precision rounds long runs
+	os << std::fixed << std::setprecision(3);
+
+	long long total[PROF_COUNTER_NUM] = { 0 };
+	std::map<std::string, double> total_phase;
+
+	os << "{" << std::endl << "\"threads\": [" << std::endl;
+	for (int i = 0; i < _slots.size(); i++) {
+		ProfSlot *slot = _slots[i];
+		std::map<std::string, double> phase;
+		for (int e = 0; e < slot->_events.size(); e++) {
+			phase[slot->_events[e]._name] += slot->_events[e]._dur;
+			total_phase[slot->_events[e]._name] += slot->_events[e]._dur;
+		}
+		for (int c = 0; c < PROF_COUNTER_NUM; c++) {
+			total[c] += slot->_count[c];
+		}
+
+		os << "  {\"tid\": " << slot->_tid << ", \"counters\": ";
+		WriteCounters(os, slot->_count);
+		os << ", \"phase_us\": ";
+		WritePhases(os, phase);
+		os << "}" << ((i + 1 < _slots.size()) ? "," : "") << std::endl;
+	}
+	os << "]," << std::endl << "\"counters\": ";
+	WriteCounters(os, total);
+	os << "," << std::endl << "\"phase_us\": ";
+	WritePhases(os, total_phase);
+	os << std::endl << "}" << std::endl;
+	os.close();
+}
+
+void Profiler::WriteTrace(const std::string fn)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	std::ofstream os(fn, std::ios::out);
+	os << std::fixed << std::setprecision(3);
+
+	os << "{\"traceEvents\": [" << std::endl;
+	bool first = true;
+	for (int i = 0; i < _slots.size(); i++) {
+		ProfSlot *slot = _slots[i];
+		for (int e = 0; e < slot->_events.size(); e++) {
+			ProfEvent &ev = slot->_events[e];
+			os << (first ? "" : ",\n") << "{\"name\": \"" << ev._name <<
+				"\", \"ph\": \"X\", \"pid\": 0, \"tid\": " << slot->_tid <<
+				", \"ts\": " << ev._start << ", \"dur\": " << ev._dur << "}";
+			first = false;
+		}
+		// counters of the thread at the end of the trace
+		os << (first ? "" : ",\n") << "{\"name\": \"counters\", \"ph\": \"C\", \"pid\": 0, \"tid\": " <<
+			slot->_tid << ", \"ts\": " << Now() << ", \"args\": ";
+		WriteCounters(os, slot->_count);
+		os << "}";
+		first = false;
+	}
+	os << std::endl << "]}" << std::endl;
+	os.close();
+}
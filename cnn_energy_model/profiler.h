@@ -0,0 +1,137 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <mutex>
+#include <chrono>
+
+// Low overhead instrumentation of the optimizer. Every thread counts
+// into its own slot, slots are merged when the results are written.
+// Timed scopes are only recorded once Enable() is called. Define
+// NO_PROFILER to compile all the instrumentation out.
+
+enum ProfCounter {
+	PROF_OPT_SINGLE_LAYER,	// OptSingleLayer calls
+	PROF_CASE_REUSE_WEIGHT,	// single layer schedules reusing weights
+	PROF_CASE_REUSE_MAP,	// single layer schedules reusing feature maps
+	PROF_DP_ITER,			// cross layer DP inner loop iterations
+	PROF_PIN_LEAF,			// leaves of the weight pinning recursion
+	PROF_ACTIVITY_HIT,		// layers optimized with the precomputed activity
+	PROF_ACTIVITY_MISS,		// layers whose activity was computed on the spot
+	PROF_DESIGN_DUP,		// adaptive lattice points of an evaluated configuration
+	PROF_DESIGN_EVAL,		// adaptive configurations evaluated
+	PROF_CROSS_CACHE_HIT,	// workload cross layer results found in the cache
+	PROF_CROSS_CACHE_MISS,	// workload cross layer results computed
+	PROF_COUNTER_NUM
+};
+
+// a timed scope, in us from the start of the profiler
+class ProfEvent {
+public:
+	const char *_name;
+	double _start;
+	double _dur;
+};
+
+// the slot of a finished thread is taken over by the next new
+// thread, with the counters and events so far
+class ProfSlot {
+public:
+	int _tid;
+	bool _free;
+	long long _count[PROF_COUNTER_NUM];
+	std::vector<ProfEvent> _events;
+};
+
+// gives the slot of a thread back when the thread exits
+class ProfSlotHolder {
+public:
+	ProfSlot *_slot;
+
+public:
+	ProfSlotHolder() { _slot = nullptr; }
+	~ProfSlotHolder();
+};
+
+class Profiler {
+public:
+	// slot of the calling thread
+	static ProfSlot *Slot()
+	{
+		static thread_local ProfSlotHolder holder;
+		if (holder._slot == nullptr) {
+			holder._slot = Register();
+		}
+		return holder._slot;
+	}
+
+	// record timed scopes from now on
+	static void Enable() { _enabled = true; }
+	static bool Enabled() { return _enabled; }
+
+	// time since the profiler started (us)
+	static double Now();
+
+	// drop all the counters and events
+	static void Reset();
+
+	// merged counters and wall time per scope name, per thread
+	// and in total
+	static void WriteJSON(const std::string fn);
+
+	// timed scopes as a Chrome trace (chrome://tracing)
+	static void WriteTrace(const std::string fn);
+
+	static const char *CounterName(int c);
+
+	static void Release(ProfSlot *slot);
+
+private:
+	static ProfSlot *Register();
+
+	static bool _enabled;
+	static std::mutex _mutex;
+	static std::vector<ProfSlot *> _slots;
+	static std::chrono::steady_clock::time_point _start;
+};
+
+// record the wall time of the enclosing scope
+class ProfScope {
+public:
+	ProfScope(const char *name)
+	{
+		_name = name;
+		_start = Profiler::Enabled() ? Profiler::Now() : -1;
+	}
+
+	~ProfScope()
+	{
+		if (_start < 0) {
+			return;
+		}
+		ProfSlot *slot = Profiler::Slot();
+		// keep the trace bounded, very long sweeps only keep
+		// the first events
+		if (slot->_events.size() < 1000000) {
+			ProfEvent e;
+			e._name = _name;
+			e._start = _start;
+			e._dur = Profiler::Now() - _start;
+			slot->_events.push_back(e);
+		}
+	}
+
+private:
+	const char *_name;
+	double _start;
+};
+
+#define PROF_CAT_(X, Y) X##Y
+#define PROF_CAT(X, Y) PROF_CAT_(X, Y)
+
+#ifdef NO_PROFILER
+#define PROF_COUNT(C)
+#define PROF_SCOPE(NAME)
+#else
+#define PROF_COUNT(C) (Profiler::Slot()->_count[C]++)
+#define PROF_SCOPE(NAME) ProfScope PROF_CAT(_prof_scope_, __LINE__)(NAME)
+#endif
@@ -0,0 +1,477 @@
+#include "result_store.h"
+#include <cstring>
+#include <climits>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <io.h>
+#include <fcntl.h>
+#include <share.h>
+#include <sys/stat.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#define ALIGN8(X) ((((X) + 7) / 8) * 8)
+
+static const char RESULT_MAGIC[4] = { 'C', 'E', 'M', 'R' };
+static const unsigned int RESULT_VERSION = 2;
+// version 1 has no description, its length field is 0
+static const unsigned int RESULT_MIN_VERSION = 1;
+
+// energy in uJ as in EnergyModel::PrintCSV, time in us
+const char *RESULT_ENE_FIELD[RESULT_ENE_FIELD_NUM] = {
+	"schedule",
+	"rd_iobuf",
+	"rd_weight",
+	"rd_ddr",
+	"wr_iobuf",
+	"wr_weight",
+	"wr_ddr",
+	"bg",
+	"calc",
+	"total",
+	"time",
+	"ddr_time",
+};
+
+// cut a file to its valid part before appending
+static bool TruncateFile(const std::string fn, long long size)
+{
+#ifdef _WIN32
+	int fd;
+	if (_sopen_s(&fd, fn.c_str(), _O_RDWR | _O_BINARY, _SH_DENYNO, _S_IREAD | _S_IWRITE) != 0) {
+		return false;
+	}
+	bool ok = _chsize_s(fd, size) == 0;
+	_close(fd);
+	return ok;
+#else
+	return truncate(fn.c_str(), size) == 0;
+#endif
+}
+
+//=============================================================================
+// ResultSink
+//=============================================================================
+
+ResultSink::ResultSink()
+{
+	_key_num = 0;
+	_result_num = 0;
+	_block_rows = 0;
+	_buf_rows = 0;
+	_row_num = 0;
+}
+
+ResultSink::~ResultSink()
+{
+	Close();
+}
+
+bool ResultSink::Open(const std::string fn, const std::vector<std::string> &key_names,
+	const std::vector<std::string> &result_names, bool append, int block_rows)
+{
+	Close();
+
+	_key_num = key_names.size();
+	_result_num = result_names.size();
+	_block_rows = block_rows;
+	_buf_rows = 0;
+	_row_num = 0;
+
+	_cols.clear();
+	for (int i = 0; i < _key_num; i++) {
+		ResultColumn col;
+		col._name = key_names[i];
+		col._type = RESULT_INT32;
+		_cols.push_back(col);
+	}
+	for (int r = 0; r < _result_num; r++) {
+		for (int f = 0; f < RESULT_ENE_FIELD_NUM; f++) {
+			ResultColumn col;
+			col._name = result_names[r] + "." + RESULT_ENE_FIELD[f];
+			col._type = (f == 0) ? RESULT_UINT64 : RESULT_FLOAT64;
+			_cols.push_back(col);
+		}
+	}
+	_buf.assign(_cols.size(), std::vector<char>());
+
+	// append to an existing file with the same columns
+	ResultReader reader;
+	if (append && reader.Open(fn)) {
+		bool same = reader.SameColumns(_cols);
+		bool same_desc = reader._desc == _desc;
+		long long valid_size = reader.ValidSize();
+		_row_num = reader.RowNum();
+		reader.Close();
+
+		if (!same) {
+			std::cout << "result file " << fn << " has different columns" << std::endl;
+			return false;
+		}
+		if (!same_desc) {
+			std::cout << "result file " << fn << " is of another run" << std::endl;
+			return false;
+		}
+		if (!TruncateFile(fn, valid_size)) {
+			std::cout << "cannot truncate result file " << fn << std::endl;
+			return false;
+		}
+		_os.open(fn, std::ios::out | std::ios::binary | std::ios::app);
+		return _os.good();
+	}
+
+	_os.open(fn, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!_os) {
+		std::cout << "cannot open result file " << fn << std::endl;
+		return false;
+	}
+
+	// header
+	char pad[8] = { 0 };
+	unsigned int col_num = _cols.size();
+	unsigned int desc_len = _desc.size();
+	_os.write(RESULT_MAGIC, 4);
+	_os.write((const char *)&RESULT_VERSION, 4);
+	_os.write((const char *)&col_num, 4);
+	_os.write((const char *)&desc_len, 4);
+	_os.write(_desc.c_str(), desc_len);
+	_os.write(pad, ALIGN8(desc_len) - desc_len);
+	for (int c = 0; c < _cols.size(); c++) {
+		unsigned int type = _cols[c]._type;
+		unsigned int len = _cols[c]._name.size();
+		_os.write((const char *)&type, 4);
+		_os.write((const char *)&len, 4);
+		_os.write(_cols[c]._name.c_str(), len);
+		_os.write(pad, ALIGN8(len) - len);
+	}
+	return _os.good();
+}
+
+void ResultSink::_put(int col, const void *v)
+{
+	const char *p = (const char *)v;
+	_buf[col].insert(_buf[col].end(), p, p + _cols[col].TypeSize());
+}
+
+void ResultSink::Append(const int *keys, EnergyModel *results)
+{
+	int col = 0;
+	for (int i = 0; i < _key_num; i++) {
+		_put(col++, &keys[i]);
+	}
+	for (int r = 0; r < _result_num; r++) {
+		EnergyModel &ene = results[r];
+		double v[RESULT_ENE_FIELD_NUM - 1] = {
+			ene._rd_iobuf / 1e6,
+			ene._rd_weight / 1e6,
+			ene._rd_ddr / 1e6,
+			ene._wr_iobuf / 1e6,
+			ene._wr_weight / 1e6,
+			ene._wr_ddr / 1e6,
+			ene._bg / 1e6,
+			ene._calc / 1e6,
+			ene.Total() / 1e6,
+			ene._time,
+			ene._ddr_time,
+		};
+		_put(col++, &ene._schedule);
+		for (int f = 0; f < RESULT_ENE_FIELD_NUM - 1; f++) {
+			_put(col++, &v[f]);
+		}
+	}
+	_endRow();
+}
+
+bool ResultSink::AppendRow(ResultReader &reader, long long row)
+{
+	if (!reader.SameColumns(_cols) || row < 0 || row >= reader.RowNum()) {
+		return false;
+	}
+	for (int c = 0; c < _cols.size(); c++) {
+		_put(c, reader.Locate(c, row));
+	}
+	_endRow();
+	return true;
+}
+
+void ResultSink::_endRow()
+{
+	_row_num++;
+	if (++_buf_rows >= _block_rows) {
+		Flush();
+	}
+}
+
+void ResultSink::Flush()
+{
+	if (_buf_rows == 0 || !_os.is_open()) {
+		return;
+	}
+
+	char pad[8] = { 0 };
+	unsigned long long rows = _buf_rows;
+	_os.write((const char *)&rows, 8);
+	for (int c = 0; c < _cols.size(); c++) {
+		long long len = _buf[c].size();
+		_os.write(_buf[c].data(), len);
+		_os.write(pad, ALIGN8(len) - len);
+		_buf[c].clear();
+	}
+	_os.flush();
+	_buf_rows = 0;
+}
+
+void ResultSink::Close()
+{
+	if (_os.is_open()) {
+		Flush();
+		_os.close();
+	}
+}
+
+//=============================================================================
+// ResultReader
+//=============================================================================
+
+ResultReader::ResultReader()
+{
+	_data = nullptr;
+	_size = 0;
+	_valid_size = 0;
+	_row_num = 0;
+#ifdef _WIN32
+	_file = INVALID_HANDLE_VALUE;
+	_mapping = nullptr;
+#else
+	_fd = -1;
+#endif
+}
+
+ResultReader::~ResultReader()
+{
+	Close();
+}
+
+bool ResultReader::Open(const std::string fn)
+{
+	Close();
+
+#ifdef _WIN32
+	_file = CreateFileA(fn.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (_file == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+	LARGE_INTEGER size;
+	GetFileSizeEx(_file, &size);
+	_size = size.QuadPart;
+	if (_size > 0) {
+		_mapping = CreateFileMappingA(_file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (_mapping != nullptr) {
+			_data = (const char *)MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0);
+		}
+	}
+#else
+	_fd = open(fn.c_str(), O_RDONLY);
+	if (_fd < 0) {
+		return false;
+	}
+	struct stat st;
+	fstat(_fd, &st);
+	_size = st.st_size;
+	if (_size > 0) {
+		void *p = mmap(NULL, _size, PROT_READ, MAP_SHARED, _fd, 0);
+		_data = (p == MAP_FAILED) ? nullptr : (const char *)p;
+	}
+#endif
+	if (_data == nullptr || _size < 16 || memcmp(_data, RESULT_MAGIC, 4) != 0) {
+		Close();
+		return false;
+	}
+
+	// header
+	unsigned int version, col_num, desc_len;
+	memcpy(&version, _data + 4, 4);
+	memcpy(&col_num, _data + 8, 4);
+	memcpy(&desc_len, _data + 12, 4);
+	if (version < RESULT_MIN_VERSION || version > RESULT_VERSION || 16 + (long long)desc_len > _size) {
+		Close();
+		return false;
+	}
+	_desc.assign(_data + 16, desc_len);
+	long long off = 16 + ALIGN8((long long)desc_len);
+	for (unsigned int c = 0; c < col_num; c++) {
+		if (off + 8 > _size) {
+			Close();
+			return false;
+		}
+		unsigned int type, len;
+		memcpy(&type, _data + off, 4);
+		memcpy(&len, _data + off + 4, 4);
+		off += 8;
+		if (type > RESULT_FLOAT64 || off + len > _size) {
+			Close();
+			return false;
+		}
+		ResultColumn col;
+		col._type = type;
+		col._name.assign(_data + off, len);
+		_cols.push_back(col);
+		off += ALIGN8(len);
+	}
+
+	// index the complete blocks
+	_row_num = 0;
+	while (off + 8 <= _size) {
+		unsigned long long rows;
+		memcpy(&rows, _data + off, 8);
+		// every row takes at least 4 bytes per column, a larger row
+		// number is corrupt and would overflow the offsets
+		if (rows > INT_MAX || rows * 4 * _cols.size() > (unsigned long long)(_size - off - 8)) {
+			break;
+		}
+		long long col_off = off + 8;
+		std::vector<long long> offset;
+		for (int c = 0; c < _cols.size(); c++) {
+			offset.push_back(col_off);
+			col_off += ALIGN8((long long)rows * _cols[c].TypeSize());
+		}
+		if (col_off > _size) {
+			break;
+		}
+		_block_row.push_back(_row_num);
+		_block_rows.push_back(rows);
+		_col_offset.push_back(offset);
+		_row_num += rows;
+		off = col_off;
+	}
+	_valid_size = off;
+	return true;
+}
+
+void ResultReader::Close()
+{
+#ifdef _WIN32
+	if (_data != nullptr) UnmapViewOfFile(_data);
+	if (_mapping != nullptr) CloseHandle(_mapping);
+	if (_file != INVALID_HANDLE_VALUE) CloseHandle(_file);
+	_mapping = nullptr;
+	_file = INVALID_HANDLE_VALUE;
+#else
+	if (_data != nullptr) munmap((void *)_data, _size);
+	if (_fd >= 0) close(_fd);
+	_fd = -1;
+#endif
+	_data = nullptr;
+	_size = 0;
+	_valid_size = 0;
+	_row_num = 0;
+	_cols.clear();
+	_desc.clear();
+	_block_row.clear();
+	_block_rows.clear();
+	_col_offset.clear();
+}
+
+int ResultReader::FindColumn(const std::string name)
+{
+	for (int c = 0; c < _cols.size(); c++) {
+		if (_cols[c]._name == name) {
+			return c;
+		}
+	}
+	return -1;
+}
+
+const void *ResultReader::BlockColumn(int b, int col)
+{
+	return _data + _col_offset[b][col];
+}
+
+bool ResultReader::SameColumns(const std::vector<ResultColumn> &cols)
+{
+	bool same = _cols.size() == cols.size();
+	for (int c = 0; same && c < _cols.size(); c++) {
+		same = (_cols[c]._name == cols[c]._name) && (_cols[c]._type == cols[c]._type);
+	}
+	return same;
+}
+
+const void *ResultReader::Locate(int col, long long row)
+{
+	if (_block_row.empty() || col < 0 || col >= _cols.size() || row < 0 || row >= _row_num) {
+		return nullptr;
+	}
+
+	// binary search the block holding the row
+	int lo = 0, hi = _block_row.size() - 1;
+	while (lo < hi) {
+		int mid = (lo + hi + 1) / 2;
+		if (_block_row[mid] <= row) lo = mid;
+		else hi = mid - 1;
+	}
+	return _data + _col_offset[lo][col] + (row - _block_row[lo]) * _cols[col].TypeSize();
+}
+
+int ResultReader::GetInt(int col, long long row)
+{
+	int v = 0;
+	const void *p = Locate(col, row);
+	if (p != nullptr) memcpy(&v, p, 4);
+	return v;
+}
+
+unsigned long long ResultReader::GetUInt64(int col, long long row)
+{
+	unsigned long long v = 0;
+	const void *p = Locate(col, row);
+	if (p != nullptr) memcpy(&v, p, 8);
+	return v;
+}
+
+double ResultReader::GetDouble(int col, long long row)
+{
+	double v = 0;
+	const void *p = Locate(col, row);
+	if (p != nullptr) memcpy(&v, p, 8);
+	return v;
+}
+
+void ResultReader::ExportCSV(std::ostream &os)
+{
+	for (int c = 0; c < _cols.size(); c++) {
+		os << (c ? "," : "") << _cols[c]._name;
+	}
+	os << std::endl;
+
+	for (int b = 0; b < _block_row.size(); b++) {
+		for (int r = 0; r < _block_rows[b]; r++) {
+			for (int c = 0; c < _cols.size(); c++) {
+				const char *p = _data + _col_offset[b][c] + (long long)r * _cols[c].TypeSize();
+				if (c) os << ",";
+				if (_cols[c]._type == RESULT_INT32) {
+					int v;
+					memcpy(&v, p, 4);
+					os << v;
+				}
+				else if (_cols[c]._type == RESULT_UINT64) {
+					unsigned long long v;
+					memcpy(&v, p, 8);
+					os << v;
+				}
+				else {
+					double v;
+					memcpy(&v, p, 8);
+					os << v;
+				}
+			}
+			os << "\n";
+		}
+	}
+}
@@ -0,0 +1,147 @@
+#pragma once
+#include "model.h"
+#include <vector>
+#include <string>
+#include <fstream>
+#include <iostream>
+
+// Columnar binary store for sweep results.
+//
+// File layout, all fields little endian and 8 byte aligned:
+//   header:  "CEMR", version, column number, description length,
+//            the description, then per column its type, name length
+//            and name
+//   blocks:  row number, then the values of each column contiguously
+// Blocks are only appended, so a file cut short by a crash is still
+// readable up to its last complete block.
+
+enum ResultType {
+	RESULT_INT32,
+	RESULT_UINT64,
+	RESULT_FLOAT64,
+};
+
+class ResultColumn {
+public:
+	std::string _name;
+	int _type;
+
+public:
+	int TypeSize() {
+		return (_type == RESULT_INT32) ? 4 : 8;
+	}
+};
+
+// fields stored for each EnergyModel of a row
+const int RESULT_ENE_FIELD_NUM = 12;
+extern const char *RESULT_ENE_FIELD[RESULT_ENE_FIELD_NUM];
+
+class ResultReader;
+
+// writes result rows, buffered a block at a time
+class ResultSink {
+public:
+	std::vector<ResultColumn> _cols;
+
+	// what the results were computed from, written in the header
+	std::string _desc;
+
+public:
+	ResultSink();
+	~ResultSink();
+
+	// open a result file with integer config keys and a group of
+	// energy columns ("<name>.<field>") for each named result. The
+	// file is truncated, or with append kept if it exists with the
+	// same columns and description
+	bool Open(const std::string fn, const std::vector<std::string> &key_names,
+		const std::vector<std::string> &result_names, bool append = false,
+		int block_rows = 4096);
+
+	// append one row, keys and results in the order given to Open()
+	void Append(const int *keys, EnergyModel *results);
+
+	// append a row of a result file with the same columns,
+	// false if the reader has other columns or not the row
+	bool AppendRow(ResultReader &reader, long long row);
+
+	// write the buffered rows
+	void Flush();
+
+	void Close();
+
+	long long RowNum() { return _row_num; }
+
+	// rows not written to the file yet
+	int BufferedRows() { return _buf_rows; }
+
+private:
+	std::ofstream _os;
+	int _key_num;
+	int _result_num;
+	int _block_rows;
+	int _buf_rows;
+	long long _row_num;
+	std::vector<std::vector<char> > _buf;
+
+	void _put(int col, const void *v);
+	void _endRow();
+};
+
+// memory mapped reader of a result file
+class ResultReader {
+public:
+	std::vector<ResultColumn> _cols;
+	std::string _desc;
+
+public:
+	ResultReader();
+	~ResultReader();
+
+	bool Open(const std::string fn);
+	void Close();
+
+	long long RowNum() { return _row_num; }
+
+	// bytes up to the end of the last complete block
+	long long ValidSize() { return _valid_size; }
+
+	// column index by name, -1 if there is none
+	int FindColumn(const std::string name);
+
+	// raw value of a column in a row, nullptr if there is none
+	const void *Locate(int col, long long row);
+
+	// the same column names and types as cols
+	bool SameColumns(const std::vector<ResultColumn> &cols);
+
+	// values of a column in a row, 0 if there is none
+	int GetInt(int col, long long row);
+	unsigned long long GetUInt64(int col, long long row);
+	double GetDouble(int col, long long row);
+
+	// contiguous values of a column in block b
+	int BlockNum() { return _block_row.size(); }
+	int BlockRows(int b) { return _block_rows[b]; }
+	const void *BlockColumn(int b, int col);
+
+	// write all the rows as CSV with a header line
+	void ExportCSV(std::ostream &os);
+
+private:
+	const char *_data;
+	long long _size;
+	long long _valid_size;
+	long long _row_num;
+	std::vector<long long> _block_row;		// first row of each block
+	std::vector<int> _block_rows;			// rows of each block
+	std::vector<std::vector<long long> > _col_offset;	// offset of each column in each block
+
+#ifdef _WIN32
+	void *_file;
+	void *_mapping;
+#else
+	int _fd;
+#endif
+
+};
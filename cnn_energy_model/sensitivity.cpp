@@ -0,0 +1,332 @@
+#include "sensitivity.h"
+#include "monte_carlo.h"
+#include "profiler.h"
+#include <thread>
+#include <algorithm>
+#include <cmath>
+#include <map>
+
+Sensitivity::Sensitivity()
+{
+	_method = MC_FIXED;
+	_thread_num = std::thread::hardware_concurrency();
+	if (_thread_num <= 0) {
+		_thread_num = 1;
+	}
+	_step = 0.01;
+}
+
+// the fields of one buffer of the accelerator
+static void AddBufferParams(std::vector<SensParam> &params, const std::string name,
+	BufferModel Accelerator::*buf)
+{
+	params.push_back({ name + ".size", false, true,
+		[=](Accelerator &a) { return (double)(a.*buf)._size; },
+		[=](Accelerator &a, double v) { (a.*buf)._size = (int)v; } });
+	params.push_back({ name + ".rd_ene", false, false,
+		[=](Accelerator &a) { return (a.*buf)._unit_rd_ene; },
+		[=](Accelerator &a, double v) { (a.*buf)._unit_rd_ene = v; } });
+	params.push_back({ name + ".wr_ene", false, false,
+		[=](Accelerator &a) { return (a.*buf)._unit_wr_ene; },
+		[=](Accelerator &a, double v) { (a.*buf)._unit_wr_ene = v; } });
+	params.push_back({ name + ".bg_pwr", false, false,
+		[=](Accelerator &a) { return (a.*buf)._bg_pwr; },
+		[=](Accelerator &a, double v) { (a.*buf)._bg_pwr = v; } });
+	params.push_back({ name + ".rd_bw", false, false,
+		[=](Accelerator &a) { return (a.*buf)._rd_bw; },
+		[=](Accelerator &a, double v) { (a.*buf)._rd_bw = v; } });
+	params.push_back({ name + ".wr_bw", false, false,
+		[=](Accelerator &a) { return (a.*buf)._wr_bw; },
+		[=](Accelerator &a, double v) { (a.*buf)._wr_bw = v; } });
+}
+
+void Sensitivity::AddParams(Accelerator *acc)
+{
+	AddBufferParams(_params, "iobuf", &Accelerator::_iobuf);
+	AddBufferParams(_params, "weight", &Accelerator::_weight);
+	if (acc->_use_pinned) {
+		AddBufferParams(_params, "pinned", &Accelerator::_pinned);
+	}
+	AddBufferParams(_params, "ddr", &Accelerator::_ddr);
+	AddBufferParams(_params, "fifo", &Accelerator::_acc_buf);
+
+	_params.push_back({ "mac_ene", false, false,
+		[](Accelerator &a) { return a._mac_ene; },
+		[](Accelerator &a, double v) { a._mac_ene = v; } });
+	_params.push_back({ "mac_freq", false, false,
+		[](Accelerator &a) { return a._mac_freq; },
+		[](Accelerator &a, double v) { a._mac_freq = v; } });
+	_params.push_back({ "pixel_p", true, true,
+		[](Accelerator &a) { return (double)a._pixel_p; },
+		[](Accelerator &a, double v) { a._pixel_p = (int)v; } });
+	_params.push_back({ "input_map_p", true, true,
+		[](Accelerator &a) { return (double)a._input_map_p; },
+		[](Accelerator &a, double v) { a._input_map_p = (int)v; } });
+	_params.push_back({ "output_map_p", true, true,
+		[](Accelerator &a) { return (double)a._output_map_p; },
+		[](Accelerator &a, double v) { a._output_map_p = (int)v; } });
+}
+
+void Sensitivity::_evalConfig(Optimizer *opt, Accelerator *acc, EnergyModel &net_ene,
+	EnergyModel *layer_ene, bool *weight_ready)
+{
+	if (_method == MC_SINGLE) {
+		net_ene = opt->OptNetworkSingle(acc, layer_ene);
+	}
+	else if (_method == MC_CROSS) {
+		for (int l = 0; l < opt->_net.size(); l++) {
+			weight_ready[l] = false;
+		}
+		net_ene = opt->OptNetworkCrossLayer(acc, weight_ready, layer_ene);
+	}
+	else {
+		net_ene = opt->OptNetworkFixedWeights(acc, layer_ene);
+	}
+}
+
+void Sensitivity::_evalThread(Optimizer *opt, int thread_id)
+{
+	PROF_SCOPE("Sensitivity");
+	int layer_num = opt->_net.size();
+	bool *weight_ready = new bool[layer_num];
+
+	for (int c = thread_id; c < _configs.size(); c += _thread_num) {
+		_evalConfig(opt, &_configs[c], _net_ene[c],
+			&_layer_ene[(long long)c * layer_num], weight_ready);
+	}
+	delete[] weight_ready;
+}
+
+void Sensitivity::_bisectThread(Optimizer *opt, Accelerator *acc, int thread_id)
+{
+	PROF_SCOPE("Sensitivity");
+	int param_num = _params.size();
+	int layer_num = opt->_net.size();
+	bool *weight_ready = new bool[layer_num];
+	std::vector<EnergyModel> layer_ene(layer_num);
+
+	for (int p = thread_id; p < param_num; p += _thread_num) {
+		SensParam &param = _params[p];
+
+		// the results that flip, network first, and the schedules of
+		// each parameter value evaluated, shared by their bisections
+		std::vector<SensResult *> flips;
+		std::vector<int> targets;
+		if (_net_res[p]._flip) {
+			flips.push_back(&_net_res[p]);
+			targets.push_back(layer_num);
+		}
+		for (int l = 0; l < layer_num; l++) {
+			if (_layer_res[(long long)l * param_num + p]._flip) {
+				flips.push_back(&_layer_res[(long long)l * param_num + p]);
+				targets.push_back(l);
+			}
+		}
+		if (flips.empty()) {
+			continue;
+		}
+
+		std::map<double, std::vector<unsigned long long> > schedules;
+		int configs[3] = { 2 * p + 1, 0, 2 * p + 2 };
+		double values[3] = { param._get(_configs[2 * p + 1]), param._get(*acc),
+			param._get(_configs[2 * p + 2]) };
+		for (int i = 0; i < 3; i++) {
+			std::vector<unsigned long long> &s = schedules[values[i]];
+			for (int l = 0; l < layer_num; l++) {
+				s.push_back(_layer_ene[(long long)configs[i] * layer_num + l]._schedule);
+			}
+			s.push_back(_net_ene[configs[i]]._schedule);
+		}
+
+		for (int f = 0; f < flips.size(); f++) {
+			int t = targets[f];
+			double lo = values[0], hi = values[1];
+			if (schedules[lo][t] == schedules[hi][t]) {
+				lo = values[1];
+				hi = values[2];
+			}
+			for (int iter = 0; iter < 16; iter++) {
+				double mid = (lo + hi) / 2;
+				if (param._positive_int) {
+					if (hi - lo <= 1) {
+						break;
+					}
+					mid = std::floor(mid);
+				}
+				auto it = schedules.find(mid);
+				if (it == schedules.end()) {
+					Accelerator acc_mid = *acc;
+					param._set(acc_mid, mid);
+					EnergyModel net_ene;
+					_evalConfig(opt, &acc_mid, net_ene, layer_ene.data(), weight_ready);
+					std::vector<unsigned long long> s;
+					for (int l = 0; l < layer_num; l++) {
+						s.push_back(layer_ene[l]._schedule);
+					}
+					s.push_back(net_ene._schedule);
+					it = schedules.insert(std::make_pair(mid, s)).first;
+				}
+				if (it->second[t] == schedules[lo][t]) {
+					lo = mid;
+				}
+				else {
+					hi = mid;
+				}
+			}
+			flips[f]->_flip_at = hi;
+		}
+	}
+	delete[] weight_ready;
+}
+
+SensResult Sensitivity::_diff(int p, const EnergyModel &base, const EnergyModel &down,
+	const EnergyModel &up, double x_base, double x_down, double x_up)
+{
+	EnergyModel b = base, d = down, u = up;
+	SensResult res;
+	res._param = p;
+	res._base = 0;
+	res._one_sided = x_down >= x_base;
+	if (res._one_sided) {
+		d = b;
+		x_down = x_base;
+	}
+	double dx = std::log(x_up / x_down);
+	res._ene = (b.Total() > 0) ? (u.Total() - d.Total()) / b.Total() / dx : 0;
+	res._time = (b._time > 0) ? (u._time - d._time) / b._time / dx : 0;
+	res._flip = (d._schedule != b._schedule) || (u._schedule != b._schedule);
+	res._flip_at = 0;
+	return res;
+}
+
+void Sensitivity::Run(Optimizer *opt, Accelerator *acc)
+{
+	int param_num = _params.size();
+	int layer_num = opt->_net.size();
+
+	// the base configuration, then two steps per parameter
+	std::vector<double> base(param_num), x_down(param_num), x_up(param_num);
+	_configs.assign(1, *acc);
+	for (int p = 0; p < param_num; p++) {
+		SensParam &param = _params[p];
+		double x = param._get(*acc);
+		double down, up;
+		if (param._discrete) {
+			down = std::max(1.0, std::floor(x / 2));
+			up = x * 2;
+		}
+		else if (param._positive_int) {
+			double dx = std::max(1.0, std::floor(x * _step + 0.5));
+			down = std::max(1.0, x - dx);
+			up = x + dx;
+		}
+		else {
+			down = x * (1 - _step);
+			up = x * (1 + _step);
+		}
+		base[p] = x;
+		x_down[p] = down;
+		x_up[p] = up;
+
+		Accelerator acc_down = *acc, acc_up = *acc;
+		param._set(acc_down, down);
+		param._set(acc_up, up);
+		_configs.push_back(acc_down);
+		_configs.push_back(acc_up);
+	}
+
+	// the steps of the parallelism and fifo size change the array shape
+	for (int c = 0; c < _configs.size(); c++) {
+		opt->Precompute(&_configs[c]);
+	}
+
+	_net_ene.assign(_configs.size(), EnergyModel());
+	_layer_ene.assign(_configs.size() * layer_num, EnergyModel());
+	_thread_num = std::max(_thread_num, 1);
+	std::vector<std::thread> threads;
+	for (int t = 0; t < _thread_num; t++) {
+		threads.push_back(std::thread(&Sensitivity::_evalThread, this, opt, t));
+	}
+	for (int t = 0; t < threads.size(); t++) {
+		threads[t].join();
+	}
+
+	// parameters at 0 (unused fields) have no elasticity
+	_net_res.clear();
+	_layer_res.clear();
+	for (int l = 0; l < layer_num; l++) {
+		for (int p = 0; p < param_num; p++) {
+			SensResult res = { p, base[p], 0, 0, false, 0, false };
+			if (base[p] > 0 && x_up[p] > x_down[p]) {
+				res = _diff(p, _layer_ene[l], _layer_ene[(2 * p + 1) * layer_num + l],
+					_layer_ene[(2 * p + 2) * layer_num + l], base[p], x_down[p], x_up[p]);
+				res._base = base[p];
+			}
+			_layer_res.push_back(res);
+		}
+	}
+	for (int p = 0; p < param_num; p++) {
+		SensResult res = { p, base[p], 0, 0, false, 0, false };
+		if (base[p] > 0 && x_up[p] > x_down[p]) {
+			res = _diff(p, _net_ene[0], _net_ene[2 * p + 1], _net_ene[2 * p + 2],
+				base[p], x_down[p], x_up[p]);
+			res._base = base[p];
+		}
+		_net_res.push_back(res);
+	}
+
+	// the values the schedules flip at, the configurations between
+	// the steps are not precomputed, as the threads share the optimizer
+	threads.clear();
+	for (int t = 0; t < _thread_num; t++) {
+		threads.push_back(std::thread(&Sensitivity::_bisectThread, this, opt, acc, t));
+	}
+	for (int t = 0; t < threads.size(); t++) {
+		threads[t].join();
+	}
+}
+
+void Sensitivity::_printRanked(std::ostream &os, const SensResult *res, int num, int top_num)
+{
+	std::vector<SensResult> ranked(res, res + num);
+	std::stable_sort(ranked.begin(), ranked.end(), [](const SensResult &a, const SensResult &b) {
+		return std::fabs(a._ene) > std::fabs(b._ene);
+	});
+	for (int i = 0; i < ranked.size() && i < top_num; i++) {
+		SensResult &r = ranked[i];
+		if (r._ene == 0 && r._time == 0 && !r._flip) {
+			break;
+		}
+		os << "\t" << _params[r._param]._name << "\t" << r._base << "\t" <<
+			r._ene << "\t" << r._time;
+		if (r._one_sided) {
+			os << "\tone-sided";
+		}
+		if (r._flip) {
+			os << "\tflip at " << r._flip_at;
+		}
+		os << std::endl;
+	}
+}
+
+void Sensitivity::Report(std::ostream &os, int top_num)
+{
+	int param_num = _params.size();
+	if (_net_res.empty()) {
+		return;
+	}
+
+	os << "===================================" << std::endl;
+	os << "elasticity d ln(x) / d ln(param), \"flip at v\" if the schedule changes at v within the step" << std::endl;
+	os << "\"one-sided\" if the value can not be stepped down, the elasticity is then a forward difference" << std::endl;
+	os << "network" << std::endl;
+	os << "\tparam\tvalue\tenergy\ttime" << std::endl;
+	_printRanked(os, _net_res.data(), param_num, param_num);
+
+	int layer_num = _layer_res.size() / param_num;
+	for (int l = 0; l < layer_num; l++) {
+		os << "-----------------------------------" << std::endl;
+		os << "layer " << l << std::endl;
+		_printRanked(os, _layer_res.data() + (long long)l * param_num, param_num, top_num);
+	}
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include "optimizer.h"
+#include <vector>
+#include <string>
+#include <functional>
+#include <iostream>
+
+// a parameter of the accelerator the sensitivity is taken for
+class SensParam {
+public:
+	std::string _name;
+	// stepped by halving and doubling instead of a relative step
+	bool _discrete;
+	// kept at least 1 when stepped down
+	bool _positive_int;
+	std::function<double(Accelerator &)> _get;
+	std::function<void(Accelerator &, double)> _set;
+};
+
+// elasticity of one result to one parameter, d ln(result) / d ln(param)
+class SensResult {
+public:
+	int _param;
+	double _base;		// parameter value
+	double _ene;		// energy elasticity
+	double _time;		// latency elasticity
+	bool _flip;			// the schedule differs between the two steps
+	// the schedule below this value differs from the one at it,
+	// found by bisection within the step
+	double _flip_at;
+	// the step down is clamped at the value (e.g. a size of 1), the
+	// elasticity is a forward difference
+	bool _one_sided;
+};
+
+// Sensitivity of the optimized energy and latency to every buffer field,
+// the MAC energy and clock and the parallelism factors, by central finite
+// differences. The perturbed configurations are evaluated in parallel,
+// for the whole network and for each layer under the network schedule.
+class Sensitivity {
+public:
+	std::vector<SensParam> _params;
+	int _method;		// MC_SINGLE, MC_CROSS or MC_FIXED of monte_carlo.h
+	int _thread_num;
+	double _step;		// relative step of the continuous parameters
+
+	std::vector<SensResult> _net_res;
+	// result of parameter p on layer l at l * parameter number + p
+	std::vector<SensResult> _layer_res;
+
+public:
+	Sensitivity();
+
+	// the parameters of acc, buffers that do not exist are left out
+	void AddParams(Accelerator *acc);
+
+	void Run(Optimizer *opt, Accelerator *acc);
+
+	// parameters ranked by the energy elasticity, for the network
+	// and the top_num of each layer
+	void Report(std::ostream &os, int top_num);
+
+private:
+	// the perturbed configurations of each parameter, down then up
+	std::vector<Accelerator> _configs;
+	std::vector<EnergyModel> _net_ene;
+	std::vector<EnergyModel> _layer_ene;
+
+	void _evalThread(Optimizer *opt, int thread_id);
+
+	// the network and layer energy of one configuration
+	void _evalConfig(Optimizer *opt, Accelerator *acc, EnergyModel &net_ene,
+		EnergyModel *layer_ene, bool *weight_ready);
+
+	// the flip values of the parameters of the thread
+	void _bisectThread(Optimizer *opt, Accelerator *acc, int thread_id);
+
+	SensResult _diff(int p, const EnergyModel &base, const EnergyModel &down,
+		const EnergyModel &up, double x_base, double x_down, double x_up);
+
+	void _printRanked(std::ostream &os, const SensResult *res, int num, int top_num);
+};
@@ -0,0 +1,47 @@
+#include "shape_eval.h"
+
+template <int PIXEL_P_, int INPUT_MAP_P, int OUTPUT_MAP_P, int ACC_SIZE>
+static LayerActivity FixedActivity(Accelerator *acc, Layer *l)
+{
+	return ShapeActivity(FixedShape<PIXEL_P_, INPUT_MAP_P, OUTPUT_MAP_P, ACC_SIZE>(acc), l);
+}
+
+static LayerActivity RuntimeActivity(Accelerator *acc, Layer *l)
+{
+	return ShapeActivity(RuntimeShape(acc), l);
+}
+
+// one instantiation per fifo size in FIFO_SIZE
+template <int PIXEL_P_, int INPUT_MAP_P, int OUTPUT_MAP_P>
+static ActivityFunc FindFifo(int acc_size)
+{
+	switch (acc_size) {
+	case 1: return FixedActivity<PIXEL_P_, INPUT_MAP_P, OUTPUT_MAP_P, 1>;
+	case 16: return FixedActivity<PIXEL_P_, INPUT_MAP_P, OUTPUT_MAP_P, 16>;
+	case 32: return FixedActivity<PIXEL_P_, INPUT_MAP_P, OUTPUT_MAP_P, 32>;
+	case 64: return FixedActivity<PIXEL_P_, INPUT_MAP_P, OUTPUT_MAP_P, 64>;
+	case 128: return FixedActivity<PIXEL_P_, INPUT_MAP_P, OUTPUT_MAP_P, 128>;
+	default: return nullptr;
+	}
+}
+
+ActivityFunc FindActivityFunc(Accelerator *acc)
+{
+	ActivityFunc func = nullptr;
+	int p = acc->_pixel_p;
+	int i = acc->_input_map_p;
+	int o = acc->_output_map_p;
+
+	// pixel x input map x output map parallelism of the arrays we build
+	if (p == 8 && i == 8 && o == 8) {
+		func = FindFifo<8, 8, 8>(acc->_acc_buf._size);
+	}
+	else if (p == 16 && i == 16 && o == 4) {
+		func = FindFifo<16, 16, 4>(acc->_acc_buf._size);
+	}
+	else if (p == 16 && i == 16 && o == 16) {
+		func = FindFifo<16, 16, 16>(acc->_acc_buf._size);
+	}
+
+	return (func != nullptr) ? func : RuntimeActivity;
+}
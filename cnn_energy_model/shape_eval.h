@@ -0,0 +1,102 @@
+#pragma once
+#include "optimizer.h"
+
+// Activity of one group of a layer (see Optimizer::GetActivity)
+// evaluated for a MAC array shape. The body is written once
+// against a shape policy: FixedShape makes the parallelism factors and the
+// fifo size compile-time constants, so the divisions by them and the
+// single-entry fifo branch fold away, RuntimeShape reads them from the
+// accelerator for any other shape.
+
+#define SHAPE_CEIL_DIV(X, Y) (((X) + (Y) - 1) / (Y))
+
+template <int PIXEL_P_, int INPUT_MAP_P, int OUTPUT_MAP_P, int ACC_SIZE>
+class FixedShape {
+public:
+	FixedShape(Accelerator *) {}
+
+	static constexpr int PixelP() { return PIXEL_P_; }
+	static constexpr int InputMapP() { return INPUT_MAP_P; }
+	static constexpr int OutputMapP() { return OUTPUT_MAP_P; }
+	static constexpr int AccSize() { return ACC_SIZE; }
+};
+
+class RuntimeShape {
+public:
+	int _pixel_p;
+	int _input_map_p;
+	int _output_map_p;
+	int _acc_size;
+
+public:
+	RuntimeShape(Accelerator *acc)
+	{
+		_pixel_p = acc->_pixel_p;
+		_input_map_p = acc->_input_map_p;
+		_output_map_p = acc->_output_map_p;
+		_acc_size = acc->_acc_buf._size;
+	}
+
+	int PixelP() const { return _pixel_p; }
+	int InputMapP() const { return _input_map_p; }
+	int OutputMapP() const { return _output_map_p; }
+	int AccSize() const { return _acc_size; }
+};
+
+template <class Shape>
+LayerActivity ShapeActivity(const Shape &s, Layer *l)
+{
+	LayerActivity act;
+	if (l->_type == LAYER_POOL) {
+		// every input datum is read once, channels in parallel
+		act._rd_iobuf = l->GetInputMapSize();
+		act._wr_iobuf = l->GetOutputMapSize();
+		act._rd_weight = 0;
+		act._mac = 0;
+		act._acc = 0;
+		act._cycle = (double)SHAPE_CEIL_DIV(l->_input_map_x * l->_input_map_y, s.PixelP()) *
+			SHAPE_CEIL_DIV(l->_input_map_num, s.InputMapP());
+		return act;
+	}
+
+	int output_map_x, output_map_y;
+	l->GetConvOutputShape(output_map_x, output_map_y);
+
+	// data read from input buffer
+	if (l->_kernel_str == 1 && s.AccSize() == 1) {
+		act._rd_iobuf =
+			output_map_y * SHAPE_CEIL_DIV(output_map_x, s.PixelP()) *	// output pixel group number
+			(l->_kernel_x + s.PixelP() - 1) * l->_kernel_y;				// input pixel group size
+	}
+	else {
+		act._rd_iobuf = output_map_x * output_map_y *
+			(l->_kernel_x * l->_kernel_y);
+	}
+
+	// result write to output buffer
+	act._wr_iobuf = l->GetOutputMapSize();
+
+	// weight read from weight buffer
+	act._rd_weight =
+		l->GetWeightSize() *
+		SHAPE_CEIL_DIV(output_map_x * SHAPE_CEIL_DIV(output_map_y, s.PixelP()), s.AccSize());
+
+	// calculation and partial sum accumulation
+	act._mac = l->GetMacNum();
+	act._acc = (output_map_x * output_map_y * l->_output_map_num) *
+		(SHAPE_CEIL_DIV(l->_input_map_num, s.InputMapP()) * l->_kernel_x * l->_kernel_y - 1);
+
+	// calculation cycles
+	double cycle_num;
+	cycle_num = output_map_y * SHAPE_CEIL_DIV(output_map_x, s.PixelP());
+	cycle_num *= SHAPE_CEIL_DIV(l->_input_map_num, s.InputMapP()) *
+		SHAPE_CEIL_DIV(l->_output_map_num, s.OutputMapP());
+	cycle_num *= l->_kernel_x * l->_kernel_y;
+	act._cycle = cycle_num;
+
+	return act;
+}
+
+// the evaluator specialized for the shape of acc, the runtime
+// evaluator if the shape is not one of the instantiated ones
+ActivityFunc FindActivityFunc(Accelerator *acc);
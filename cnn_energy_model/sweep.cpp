@@ -0,0 +1,328 @@
+#include "sweep.h"
+#include "profiler.h"
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <cstdio>
+#include <cstring>
+
+static const char PROGRESS_MAGIC[4] = { 'C', 'E', 'M', 'P' };
+
+SweepDriver::SweepDriver(const std::vector<std::string> &key_names, const std::vector<int> &dims,
+	const std::vector<std::string> &result_names)
+{
+	_key_names = key_names;
+	_dims = dims;
+	_result_names = result_names;
+	_shard_id = 0;
+	_shard_num = 1;
+	_checkpoint_rows = 64;
+}
+
+bool SweepDriver::SetShard(int shard_id, int shard_num)
+{
+	if (shard_num <= 0 || shard_id < 0 || shard_id >= shard_num) {
+		return false;
+	}
+	_shard_id = shard_id;
+	_shard_num = shard_num;
+	return true;
+}
+
+int SweepDriver::PointNum()
+{
+	int num = 1;
+	for (int d = 0; d < _dims.size(); d++) {
+		num *= _dims[d];
+	}
+	return num;
+}
+
+void SweepDriver::Decode(int point, int *keys)
+{
+	for (int d = _dims.size() - 1; d >= 0; d--) {
+		keys[d] = point % _dims[d];
+		point /= _dims[d];
+	}
+}
+
+std::string SweepDriver::ResultFile(const std::string prefix, int shard_id)
+{
+	if (_shard_num == 1) {
+		return prefix + ".bin";
+	}
+	std::ostringstream fn;
+	fn << prefix << ".s" << shard_id << "of" << _shard_num << ".bin";
+	return fn.str();
+}
+
+std::string SweepDriver::ProgressFile(const std::string prefix, int shard_id)
+{
+	return ResultFile(prefix, shard_id) + ".progress";
+}
+
+std::string SweepDriver::Fingerprint()
+{
+	std::ostringstream fp;
+	fp << _run_desc << (_run_desc.empty() ? "" : " ") << "grid=";
+	for (int d = 0; d < _dims.size(); d++) {
+		fp << (d ? "," : "") << _key_names[d] << ":" << _dims[d];
+	}
+	fp << " results=";
+	for (int r = 0; r < _result_names.size(); r++) {
+		fp << (r ? "," : "") << _result_names[r];
+	}
+	return fp.str();
+}
+
+bool SweepDriver::_newProgress(const std::string prefix)
+{
+	// "CEMP", the fingerprint length and the fingerprint
+	std::string fp = Fingerprint();
+	unsigned int len = fp.size();
+	std::ofstream log(ProgressFile(prefix, _shard_id), std::ios::out | std::ios::binary | std::ios::trunc);
+	log.write(PROGRESS_MAGIC, 4);
+	log.write((const char *)&len, 4);
+	log.write(fp.c_str(), len);
+	log.close();
+	if (!log) {
+		std::cout << "cannot write progress log " << ProgressFile(prefix, _shard_id) << std::endl;
+		return false;
+	}
+	return true;
+}
+
+bool SweepDriver::_loadProgress(const std::string prefix, std::vector<bool> &done)
+{
+	done.assign(PointNum(), false);
+	std::string fp = Fingerprint();
+	std::string result_fn = ResultFile(prefix, _shard_id);
+	std::string log_fn = ProgressFile(prefix, _shard_id);
+
+	// without results a log is stale, the sweep starts over
+	ResultReader reader;
+	if (!reader.Open(result_fn)) {
+		return _newProgress(prefix);
+	}
+	if (reader._desc != fp) {
+		std::cout << result_fn << " holds the results of another run, " <<
+			"remove it or write the results elsewhere" << std::endl;
+		std::cout << "  file:     " << reader._desc << std::endl;
+		std::cout << "  this run: " << fp << std::endl;
+		return false;
+	}
+
+	// the progress log is the fingerprint, then a list of int32 grid points
+	long long logged = 0;
+	std::ifstream log(log_fn, std::ios::in | std::ios::binary);
+	char magic[4];
+	if (!log.read(magic, 4)) {
+		log.close();
+		if (!_newProgress(prefix)) {
+			return false;
+		}
+	}
+	else {
+		unsigned int len = 0;
+		std::string log_fp;
+		if (log.read((char *)&len, 4) && memcmp(magic, PROGRESS_MAGIC, 4) == 0 && len == fp.size()) {
+			log_fp.resize(len);
+			log.read(&log_fp[0], len);
+		}
+		if (!log || log_fp != fp) {
+			std::cout << log_fn << " is the progress of another run, " <<
+				"remove it or write the results elsewhere" << std::endl;
+			return false;
+		}
+		int point;
+		while (log.read((char *)&point, 4)) {
+			if (point >= 0 && point < done.size()) {
+				done[point] = true;
+			}
+			logged++;
+		}
+		log.close();
+	}
+
+	// a crash between writing a result block and logging it leaves
+	// rows that are not in the log yet
+	int col = reader.FindColumn("point");
+	if (col < 0) {
+		std::cout << "result file has no grid point column" << std::endl;
+		return false;
+	}
+	if (reader.RowNum() > logged) {
+		std::ofstream fix(log_fn, std::ios::out | std::ios::binary | std::ios::app);
+		for (long long r = logged; r < reader.RowNum(); r++) {
+			int point = reader.GetInt(col, r);
+			if (point < 0 || point >= done.size()) {
+				std::cout << "result file has grid point " << point <<
+					" out of the grid" << std::endl;
+				return false;
+			}
+			done[point] = true;
+			fix.write((const char *)&point, 4);
+		}
+	}
+	return true;
+}
+
+bool SweepDriver::Run(const std::string prefix, SweepEval eval)
+{
+	std::vector<bool> done;
+	if (!_loadProgress(prefix, done)) {
+		return false;
+	}
+
+	std::vector<std::string> key_names = _key_names;
+	key_names.insert(key_names.begin(), "point");
+
+	ResultSink sink;
+	sink._desc = Fingerprint();
+	if (!sink.Open(ResultFile(prefix, _shard_id), key_names, _result_names, true, _checkpoint_rows)) {
+		return false;
+	}
+	std::ofstream log(ProgressFile(prefix, _shard_id),
+		std::ios::out | std::ios::binary | std::ios::app);
+
+	int skipped = 0;
+	std::vector<int> keys(_dims.size() + 1);
+	std::vector<EnergyModel> results(_result_names.size());
+	std::vector<int> pending;
+	for (int p = _shard_id; p < PointNum(); p += _shard_num) {
+		if (done[p]) {
+			skipped++;
+			continue;
+		}
+		keys[0] = p;
+		Decode(p, &keys[1]);
+		std::cout << "optimization on (";
+		for (int d = 1; d < keys.size(); d++) {
+			std::cout << (d > 1 ? "," : "") << keys[d];
+		}
+		std::cout << ")" << std::endl;
+
+		PROF_SCOPE("sweep_point");
+		eval(&keys[1], results.data());
+		sink.Append(keys.data(), results.data());
+		pending.push_back(p);
+
+		// the block is on disk, log its points
+		if (sink.BufferedRows() == 0) {
+			log.write((const char *)pending.data(), pending.size() * 4);
+			log.flush();
+			pending.clear();
+			if (_on_checkpoint) {
+				_on_checkpoint();
+			}
+		}
+	}
+	sink.Close();
+	log.write((const char *)pending.data(), pending.size() * 4);
+	log.close();
+
+	if (skipped > 0) {
+		std::cout << "resumed, " << skipped << " points skipped" << std::endl;
+	}
+	return true;
+}
+
+bool SweepDriver::Merge(const std::string prefix)
+{
+	// with one shard its result file is prefix.bin itself
+	if (_shard_num < 2) {
+		std::cout << "a merge needs at least 2 shards" << std::endl;
+		return false;
+	}
+
+	// the shards are merged into a temporary file, prefix.bin is
+	// only replaced by a complete merge
+	std::string fn = prefix + ".bin";
+	std::string tmp_fn = fn + ".tmp";
+	std::vector<std::string> key_names = _key_names;
+	key_names.insert(key_names.begin(), "point");
+	ResultSink sink;
+	sink._desc = Fingerprint();
+	if (!sink.Open(tmp_fn, key_names, _result_names)) {
+		std::cout << "cannot create merged result " << tmp_fn << std::endl;
+		return false;
+	}
+
+	bool ok = true;
+	std::vector<ResultReader *> readers;
+	std::vector<int> point_col;
+	for (int s = 0; s < _shard_num; s++) {
+		ResultReader *reader = new ResultReader;
+		if (!reader->Open(ResultFile(prefix, s))) {
+			std::cout << "cannot read shard " << ResultFile(prefix, s) << std::endl;
+			delete reader;
+			ok = false;
+			continue;
+		}
+		if (!reader->SameColumns(sink._cols)) {
+			std::cout << "shard " << ResultFile(prefix, s) << " has different columns" << std::endl;
+			delete reader;
+			ok = false;
+			continue;
+		}
+		if (reader->_desc != sink._desc) {
+			std::cout << "shard " << ResultFile(prefix, s) << " is of another run" << std::endl;
+			delete reader;
+			ok = false;
+			continue;
+		}
+		readers.push_back(reader);
+		point_col.push_back(reader->FindColumn("point"));
+	}
+
+	// locate every grid point, the last copy of a point wins
+	std::vector<int> src_reader(PointNum(), -1);
+	std::vector<long long> src_row(PointNum(), -1);
+	for (int s = 0; ok && s < readers.size(); s++) {
+		for (long long r = 0; r < readers[s]->RowNum(); r++) {
+			int p = readers[s]->GetInt(point_col[s], r);
+			if (p < 0 || p >= PointNum()) {
+				std::cout << "shard has grid point " << p << " out of the grid" << std::endl;
+				ok = false;
+				break;
+			}
+			src_reader[p] = s;
+			src_row[p] = r;
+		}
+	}
+
+	int missing = 0;
+	for (int p = 0; ok && p < PointNum(); p++) {
+		if (src_reader[p] < 0) {
+			missing++;
+			continue;
+		}
+		ok = sink.AppendRow(*readers[src_reader[p]], src_row[p]);
+	}
+	sink.Close();
+
+	for (int s = 0; s < readers.size(); s++) {
+		delete readers[s];
+	}
+	if (missing > 0) {
+		std::cout << missing << " grid points missing in the shards" << std::endl;
+		ok = false;
+	}
+	if (!ok) {
+		std::remove(tmp_fn.c_str());
+		return false;
+	}
+
+	// rename() does not replace a file on Windows. The progress log
+	// of an unsharded run is rebuilt from the merged rows.
+	if (std::rename(tmp_fn.c_str(), fn.c_str()) != 0) {
+		std::remove(fn.c_str());
+		if (std::rename(tmp_fn.c_str(), fn.c_str()) != 0) {
+			std::cout << "cannot replace " << fn << std::endl;
+			std::remove(tmp_fn.c_str());
+			return false;
+		}
+	}
+	std::remove((fn + ".progress").c_str());
+	return true;
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include "model.h"
+#include "result_store.h"
+#include <vector>
+#include <string>
+#include <functional>
+
+// evaluate one grid point, results in the order of the result names
+typedef std::function<void(const int *keys, EnergyModel *results)> SweepEval;
+
+// Runs a cartesian sweep into a result file and survives preemption.
+// Completed grid points are appended to a progress log each time a
+// result block is written, so a restarted sweep skips them. The grid
+// can be split into shards, point p belongs to shard p % shard_num,
+// and the shard results are merged afterwards. The result file and
+// the progress log start with the fingerprint of the run, a sweep
+// only resumes or merges files of the same run.
+class SweepDriver {
+public:
+	std::vector<std::string> _key_names;
+	std::vector<int> _dims;
+	std::vector<std::string> _result_names;
+
+	int _shard_id;
+	int _shard_num;
+	int _checkpoint_rows;	// grid points between checkpoints
+
+	// called after each checkpoint if set
+	std::function<void()> _on_checkpoint;
+
+	// what the results depend on besides the grid and the result
+	// names, e.g. the mode, the network and the DDR profile
+	std::string _run_desc;
+
+public:
+	SweepDriver(const std::vector<std::string> &key_names, const std::vector<int> &dims,
+		const std::vector<std::string> &result_names);
+
+	// false unless 0 <= shard_id < shard_num
+	bool SetShard(int shard_id, int shard_num);
+
+	int PointNum();
+
+	// grid point index to keys, the last key changes fastest
+	void Decode(int point, int *keys);
+
+	// result file and progress log of a shard
+	std::string ResultFile(const std::string prefix, int shard_id);
+	std::string ProgressFile(const std::string prefix, int shard_id);
+
+	// _run_desc, the grid and the result names
+	std::string Fingerprint();
+
+	// run the points of this shard that are not in the progress log,
+	// false if the files of the shard are of another run
+	bool Run(const std::string prefix, SweepEval eval);
+
+	// merge the shard result files into prefix.bin ordered by grid point,
+	// false if there are less than 2 shards, or a shard is missing, has
+	// other columns or is of another run. prefix.bin is only replaced
+	// once every shard is read.
+	bool Merge(const std::string prefix);
+
+private:
+	// grid points in the progress log, fixed up with the result file
+	bool _loadProgress(const std::string prefix, std::vector<bool> &done);
+
+	// start a progress log with the fingerprint
+	bool _newProgress(const std::string prefix);
+};
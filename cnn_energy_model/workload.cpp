@@ -0,0 +1,352 @@
+#include "workload.h"
+#include "profiler.h"
+#include <fstream>
+
+Workload::Workload()
+{
+	_max_pin_search = 16;
+}
+
+Workload::~Workload()
+{
+	for (int n = 0; n < _opt.size(); n++) {
+		delete _opt[n];
+	}
+	_opt.clear();
+}
+
+bool Workload::LoadFromFile(const std::string fn)
+{
+	for (int n = 0; n < _opt.size(); n++) {
+		delete _opt[n];
+	}
+	_opt.clear();
+	_name.clear();
+	_rate.clear();
+
+	std::ifstream is(fn, std::ios::in);
+	if (!is) {
+		std::cout << "cannot open workload file " << fn << std::endl;
+		return false;
+	}
+	int net_num = 0;
+	is >> net_num;
+	if (!is || net_num <= 0) {
+		std::cout << "workload file " << fn << " has no network number" << std::endl;
+		return false;
+	}
+
+	for (int n = 0; n < net_num; n++) {
+		std::string net_fn;
+		int rate = 0;
+		is >> net_fn >> rate;
+		if (!is || rate <= 0) {
+			std::cout << "workload file " << fn << " needs \"<model file> " <<
+				"<invocations per frame>\" for network " << n << std::endl;
+			return false;
+		}
+
+		Optimizer *opt = new Optimizer;
+		_opt.push_back(opt);
+		if (!opt->LoadNetFromFile(net_fn) || opt->_net.empty()) {
+			std::cout << "cannot load network " << net_fn << " of workload " << fn << std::endl;
+			return false;
+		}
+		_name.push_back(net_fn);
+		_rate.push_back(rate);
+	}
+	return true;
+}
+
+EnergyModel Workload::OptWorkload(Accelerator *acc)
+{
+	PROF_SCOPE("OptWorkload");
+	int net_num = _opt.size();
+
+	// every layer whose weights fit in the buffer could be shared
+	_cand_net.clear();
+	_cand_layer.clear();
+	for (int n = 0; n < net_num; n++) {
+		for (int l = 0; l < _opt[n]->_net.size(); l++) {
+			int weight_size = _opt[n]->_net[l]->GetWeightSize();
+			if (weight_size > 0 && weight_size <= acc->PinBuffer()._size) {
+				_cand_net.push_back(n);
+				_cand_layer.push_back(l);
+			}
+		}
+	}
+	_cross_cache.assign(net_num, std::map<std::pair<std::vector<bool>, int>, EnergyModel>());
+
+	std::vector<std::vector<bool> > shared(net_num);
+	for (int n = 0; n < net_num; n++) {
+		shared[n].assign(_opt[n]->_net.size(), false);
+	}
+
+	// the search doubles with every candidate
+	if (_cand_net.size() > _max_pin_search) {
+		_choice = _sharedGreedy(acc, shared);
+	}
+	else {
+		_choice = _optSharedSub(acc, 0, shared);
+	}
+	_cross_cache.clear();
+	return _choice._ene;
+}
+
+double Workload::Throughput(EnergyModel &frame_ene)
+{
+	return (frame_ene._time > 0) ? 1e6 / frame_ene._time : 0.0;
+}
+
+void Workload::Report(std::ostream &os)
+{
+	os << "===================================" << std::endl;
+	for (int n = 0; n < _opt.size(); n++) {
+		os << _name[n] << "\tx" << _rate[n] << std::endl;
+		os << "shared:\t";
+		for (int l = 0; l < _choice._shared[n].size(); l++) {
+			if (_choice._shared[n][l]) os << l << " ";
+		}
+		os << std::endl << "swapped:\t";
+		for (int l = 0; l < _choice._swapped[n].size(); l++) {
+			if (_choice._swapped[n][l]) os << l << " ";
+		}
+		os << std::endl << "Per invocation:" << std::endl;
+		os << _choice._net_ene[n] << std::endl;
+	}
+	os << "Eviction per frame:\t" << _choice._switch_ene.Total() << std::endl;
+	os << "Frame:" << std::endl;
+	os << _choice._ene;
+	os << "Throughput(fps):\t" << Throughput(_choice._ene) << std::endl;
+	return;
+}
+
+WorkloadChoice Workload::_optSharedSub(Accelerator *acc, int c,
+	std::vector<std::vector<bool> > &shared)
+{
+	if (c >= _cand_net.size()) {
+		PROF_COUNT(PROF_PIN_LEAF);
+		return _sharedChoice(acc, shared);
+	}
+
+	int n = _cand_net[c];
+	int l = _cand_layer[c];
+	int weight_size = _opt[n]->_net[l]->GetWeightSize();
+
+	// skip the layer if its weights do not fit in the rest buffer
+	if (weight_size > acc->PinBuffer()._size) {
+		return _optSharedSub(acc, c + 1, shared);
+	}
+
+	// compare if share the weights of this layer
+	std::vector<std::vector<bool> > shared2 = shared;
+	shared2[n][l] = true;
+	Accelerator acc2 = *acc;
+	acc2.PinBuffer()._size -= weight_size;
+
+	WorkloadChoice choice1 = _optSharedSub(acc, c + 1, shared);
+	WorkloadChoice choice2 = _optSharedSub(&acc2, c + 1, shared2);
+
+	return (choice1._ene.Total() < choice2._ene.Total()) ? choice1 : choice2;
+}
+
+WorkloadChoice Workload::_sharedGreedy(Accelerator *acc, std::vector<std::vector<bool> > &shared)
+{
+	Accelerator cur_acc = *acc;
+	WorkloadChoice best = _sharedChoice(&cur_acc, shared);
+	for (int c = 0; c < _cand_net.size(); c++) {
+		int n = _cand_net[c];
+		int l = _cand_layer[c];
+		int weight_size = _opt[n]->_net[l]->GetWeightSize();
+		if (weight_size > cur_acc.PinBuffer()._size) {
+			continue;
+		}
+		PROF_COUNT(PROF_PIN_LEAF);
+		Accelerator acc2 = cur_acc;
+		acc2.PinBuffer()._size -= weight_size;
+		shared[n][l] = true;
+		WorkloadChoice choice = _sharedChoice(&acc2, shared);
+		if (choice._ene.Total() < best._ene.Total()) {
+			best = choice;
+			cur_acc = acc2;
+		}
+		else {
+			shared[n][l] = false;
+		}
+	}
+	return best;
+}
+
+WorkloadChoice Workload::_sharedChoice(Accelerator *acc, std::vector<std::vector<bool> > &shared)
+{
+	int net_num = _opt.size();
+	int active_num = 0;
+	for (int n = 0; n < net_num; n++) {
+		active_num += (_rate[n] > 0) ? 1 : 0;
+	}
+
+	WorkloadChoice choice;
+	choice._shared = shared;
+	choice._swapped.resize(net_num);
+	choice._net_ene.resize(net_num);
+	for (int n = 0; n < net_num; n++) {
+		std::vector<bool> ready = shared[n];
+		std::vector<bool> swapped(ready.size(), false);
+		// with a single network nothing gets evicted, so all
+		// its pinned weights are shared
+		if (active_num > 1 && _rate[n] > 0) {
+			_optSwapped(acc, n, ready, swapped);
+		}
+
+		Accelerator acc2 = *acc;
+		for (int l = 0; l < swapped.size(); l++) {
+			acc2.PinBuffer()._size -= swapped[l] ? _opt[n]->_net[l]->GetWeightSize() : 0;
+		}
+		EnergyModel inv_ene = _crossLayer(&acc2, n, ready);
+		EnergyModel switch_ene = _switchEnergy(acc, n, swapped);
+		EnergyModel net_ene = inv_ene * _rate[n];
+
+		choice._swapped[n] = swapped;
+		choice._net_ene[n] = inv_ene;
+		choice._switch_ene = choice._switch_ene + switch_ene;
+		choice._ene = choice._ene + net_ene;
+		choice._ene.AddSchedule(net_ene._schedule);
+	}
+	choice._ene = choice._ene + choice._switch_ene;
+	return choice;
+}
+
+EnergyModel Workload::_optSwapped(Accelerator *acc, int n, std::vector<bool> &ready,
+	std::vector<bool> &swapped)
+{
+	int candidate_num = 0;
+	for (int l = 0; l < ready.size(); l++) {
+		int weight_size = _opt[n]->_net[l]->GetWeightSize();
+		if (!ready[l] && weight_size > 0 && weight_size <= acc->PinBuffer()._size) {
+			candidate_num++;
+		}
+	}
+	if (candidate_num > _max_pin_search) {
+		return _swappedGreedy(acc, n, ready, swapped);
+	}
+	return _optSwappedSub(acc, n, 0, ready, swapped);
+}
+
+EnergyModel Workload::_optSwappedSub(Accelerator *acc, int n, int l,
+	std::vector<bool> &ready, std::vector<bool> &swapped)
+{
+	Net &net = _opt[n]->_net;
+	if (l >= net.size()) {
+		PROF_COUNT(PROF_PIN_LEAF);
+		return _frameEnergy(acc, n, ready, swapped);
+	}
+
+	// shared weights are already there, and the rest buffer
+	// may be too small for this layer
+	int weight_size = net[l]->GetWeightSize();
+	if (ready[l] || weight_size == 0 || weight_size > acc->PinBuffer()._size) {
+		return _optSwappedSub(acc, n, l + 1, ready, swapped);
+	}
+
+	// compare if load the weights of this layer at switch
+	std::vector<bool> ready1 = ready;
+	std::vector<bool> swapped1 = swapped;
+	std::vector<bool> ready2 = ready;
+	std::vector<bool> swapped2 = swapped;
+	ready2[l] = true;
+	swapped2[l] = true;
+
+	Accelerator acc2 = *acc;
+	acc2.PinBuffer()._size -= weight_size;
+
+	EnergyModel ene1 = _optSwappedSub(acc, n, l + 1, ready1, swapped1);
+	EnergyModel ene2 = _optSwappedSub(&acc2, n, l + 1, ready2, swapped2);
+
+	if (ene1.Total() < ene2.Total()) {
+		ready = ready1;
+		swapped = swapped1;
+		return ene1;
+	}
+	ready = ready2;
+	swapped = swapped2;
+	return ene2;
+}
+
+EnergyModel Workload::_swappedGreedy(Accelerator *acc, int n, std::vector<bool> &ready,
+	std::vector<bool> &swapped)
+{
+	Net &net = _opt[n]->_net;
+	Accelerator cur_acc = *acc;
+	EnergyModel best = _frameEnergy(&cur_acc, n, ready, swapped);
+	for (int l = 0; l < net.size(); l++) {
+		int weight_size = net[l]->GetWeightSize();
+		if (ready[l] || weight_size == 0 || weight_size > cur_acc.PinBuffer()._size) {
+			continue;
+		}
+		PROF_COUNT(PROF_PIN_LEAF);
+		Accelerator acc2 = cur_acc;
+		acc2.PinBuffer()._size -= weight_size;
+		ready[l] = true;
+		swapped[l] = true;
+		EnergyModel ene = _frameEnergy(&acc2, n, ready, swapped);
+		if (ene.Total() < best.Total()) {
+			best = ene;
+			cur_acc = acc2;
+		}
+		else {
+			ready[l] = false;
+			swapped[l] = false;
+		}
+	}
+	return best;
+}
+
+EnergyModel Workload::_frameEnergy(Accelerator *acc, int n,
+	std::vector<bool> &ready, std::vector<bool> &swapped)
+{
+	EnergyModel inv_ene = _crossLayer(acc, n, ready);
+	EnergyModel switch_ene = _switchEnergy(acc, n, swapped);
+	EnergyModel ene = inv_ene * _rate[n];
+	return ene + switch_ene;
+}
+
+EnergyModel Workload::_crossLayer(Accelerator *acc, int n, std::vector<bool> &ready)
+{
+	std::pair<std::vector<bool>, int> key(ready, acc->_weight._size);
+	auto it = _cross_cache[n].find(key);
+	if (it != _cross_cache[n].end()) {
+		PROF_COUNT(PROF_CROSS_CACHE_HIT);
+		return it->second;
+	}
+	PROF_COUNT(PROF_CROSS_CACHE_MISS);
+
+	bool *weight_ready = new bool[ready.size()];
+	for (int l = 0; l < ready.size(); l++) {
+		weight_ready[l] = ready[l];
+	}
+	EnergyModel ene = _opt[n]->OptNetworkCrossLayer(acc, weight_ready);
+	delete[] weight_ready;
+
+	_cross_cache[n][key] = ene;
+	return ene;
+}
+
+EnergyModel Workload::_switchEnergy(Accelerator *acc, int n, std::vector<bool> &swapped)
+{
+	EnergyModel ene;
+	BufferModel &pin = acc->PinBuffer();
+	double time = 0.0;
+	for (int l = 0; l < swapped.size(); l++) {
+		if (!swapped[l]) {
+			continue;
+		}
+		Layer *layer = _opt[n]->_net[l];
+		int weight_size = layer->GetWeightSize();
+		Optimizer::ChargeDDR(acc, layer, ene, 0, weight_size, 0);
+		ene._wr_weight += weight_size * pin._unit_wr_ene;
+		time += weight_size / MIN(acc->_ddr._rd_bw, pin._wr_bw);
+	}
+	ene._time += time;
+	ene._bg += acc->BackgroundPower() * time * 1000;
+	return ene;
+}
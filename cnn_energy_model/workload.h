@@ -0,0 +1,93 @@
+#pragma once
+#include "optimizer.h"
+#include <vector>
+#include <map>
+#include <string>
+#include <iostream>
+
+// pinning decision and energy of a workload
+class WorkloadChoice {
+public:
+	EnergyModel _ene;							// energy of one frame
+	EnergyModel _switch_ene;					// eviction traffic of one frame
+	std::vector<EnergyModel> _net_ene;			// energy of one invocation
+	std::vector<std::vector<bool> > _shared;	// weights resident for the whole workload
+	std::vector<std::vector<bool> > _swapped;	// weights loaded when switching to the network
+};
+
+// several networks time-multiplexed on one accelerator. In each frame
+// every network runs all its invocations back to back, so the
+// accelerator switches to each network once per frame.
+class Workload {
+public:
+	std::vector<Optimizer *> _opt;
+	std::vector<std::string> _name;
+	std::vector<int> _rate;			// invocations per frame
+
+	// result of the last optimization
+	WorkloadChoice _choice;
+
+	// the shared and the swapped weights are searched over every
+	// subset of up to this many layers, and greedily beyond
+	int _max_pin_search;
+
+public:
+	Workload();
+	~Workload();
+
+	// load a workload file: the number of networks, then one
+	// "<model file> <invocations per frame>" line per network.
+	// false if the file or one of its networks can not be read
+	bool LoadFromFile(const std::string fn);
+
+	// jointly decide which layers of all the networks keep their
+	// weights resident, the energy of one frame is returned
+	EnergyModel OptWorkload(Accelerator *acc);
+
+	// frames per second of a frame schedule
+	static double Throughput(EnergyModel &frame_ene);
+
+	// print the pinning decision and energy of the last optimization
+	void Report(std::ostream &os);
+
+private:
+	// layers of all the networks that can be pinned
+	std::vector<int> _cand_net;
+	std::vector<int> _cand_layer;
+
+	// cross layer results of each network, by pinned layers
+	// and the size of the streamed weight buffer
+	std::vector<std::map<std::pair<std::vector<bool>, int>, EnergyModel> > _cross_cache;
+
+	// decide the shared weights from candidate c on
+	WorkloadChoice _optSharedSub(Accelerator *acc, int c, std::vector<std::vector<bool> > &shared);
+
+	// share candidates one by one while the frame energy falls
+	WorkloadChoice _sharedGreedy(Accelerator *acc, std::vector<std::vector<bool> > &shared);
+
+	// swapped weights and energy of the given shared weights
+	WorkloadChoice _sharedChoice(Accelerator *acc, std::vector<std::vector<bool> > &shared);
+
+	// decide the weights of network n loaded at switch, the energy
+	// of one frame of the network is returned
+	EnergyModel _optSwapped(Accelerator *acc, int n, std::vector<bool> &ready,
+		std::vector<bool> &swapped);
+
+	// from layer l on
+	EnergyModel _optSwappedSub(Accelerator *acc, int n, int l, std::vector<bool> &ready,
+		std::vector<bool> &swapped);
+
+	// swap layers one by one while the frame energy falls
+	EnergyModel _swappedGreedy(Accelerator *acc, int n, std::vector<bool> &ready,
+		std::vector<bool> &swapped);
+
+	// energy of one frame of network n with the given pinned layers
+	EnergyModel _frameEnergy(Accelerator *acc, int n, std::vector<bool> &ready,
+		std::vector<bool> &swapped);
+
+	// cross layer optimization of network n with a cache
+	EnergyModel _crossLayer(Accelerator *acc, int n, std::vector<bool> &ready);
+
+	// energy of loading the swapped weights of network n
+	EnergyModel _switchEnergy(Accelerator *acc, int n, std::vector<bool> &swapped);
+};
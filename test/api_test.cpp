@@ -0,0 +1,113 @@
+#include "cem_api.h"
+#include "test_util.h"
+#include <string>
+#include <vector>
+
+static void SetBuffer(double *f, double size, double bw)
+{
+	f[0] = size;
+	f[1] = 1.0;
+	f[2] = 1.2;
+	f[3] = 0.5;
+	f[4] = bw;
+	f[5] = bw;
+}
+
+static std::vector<double> ValidAccelerator()
+{
+	std::vector<double> acc(CEM_ACC_FIELD_NUM, 0.0);
+	SetBuffer(&acc[CEM_IOBUF_SIZE], 1 << 18, 8000);
+	SetBuffer(&acc[CEM_WEIGHT_SIZE], 1 << 18, 8000);
+	SetBuffer(&acc[CEM_PINNED_SIZE], 1 << 20, 4000);
+	SetBuffer(&acc[CEM_DDR_SIZE], 1 << 30, 3200);
+	acc[CEM_DDR_RD_ENE] = 70;
+	acc[CEM_DDR_WR_ENE] = 70;
+	SetBuffer(&acc[CEM_FIFO_SIZE], 1, 16000);
+	acc[CEM_USE_PINNED] = 0;
+	acc[CEM_PIXEL_P] = 8;
+	acc[CEM_INPUT_MAP_P] = 8;
+	acc[CEM_OUTPUT_MAP_P] = 8;
+	acc[CEM_MAC_ENE] = 0.07;
+	acc[CEM_MAC_FREQ] = 1000;
+	return acc;
+}
+
+// every method rejects acc with CEM_ERR_ARG
+static void CheckRejected(cem_net *net, std::vector<double> acc)
+{
+	double result[CEM_RESULT_FIELD_NUM];
+	CHECK(cem_prepare(net, acc.data(), 1) == CEM_ERR_ARG);
+	CHECK(cem_evaluate(net, acc.data(), 1, result) == CEM_ERR_ARG);
+	for (int m = CEM_SINGLE; m <= CEM_FIXED; m++) {
+		CHECK(cem_optimize(net, m, acc.data(), 1, result, nullptr) == CEM_ERR_ARG);
+	}
+}
+
+int main()
+{
+	CHECK(cem_net_load_file(nullptr) == nullptr);
+	CHECK(cem_net_load_file("no_such_network.txt") == nullptr);
+	CHECK(cem_net_load_buffer(nullptr, 0) == nullptr);
+	std::string bad = "conv: in=0x0x0 k=3\n";
+	CHECK(cem_net_load_buffer(bad.data(), bad.size()) == nullptr);
+
+	cem_net *net = cem_net_load_file(TEST_MODEL("vgg-11-conv.txt").c_str());
+	CHECK(net != nullptr);
+	if (net == nullptr) {
+		return 1;
+	}
+	CHECK(cem_net_layer_num(net) == 8);
+	CHECK(cem_net_layer_num(nullptr) == CEM_ERR_ARG);
+
+	std::vector<double> acc = ValidAccelerator();
+	double result[CEM_RESULT_FIELD_NUM];
+	unsigned long long schedule = 0;
+
+	// null pointers, counts and methods
+	CHECK(cem_prepare(nullptr, acc.data(), 1) == CEM_ERR_ARG);
+	CHECK(cem_prepare(net, nullptr, 1) == CEM_ERR_ARG);
+	CHECK(cem_prepare(net, acc.data(), -1) == CEM_ERR_ARG);
+	CHECK(cem_evaluate(net, acc.data(), 1, nullptr) == CEM_ERR_ARG);
+	CHECK(cem_evaluate(net, acc.data(), -1, result) == CEM_ERR_ARG);
+	CHECK(cem_optimize(net, CEM_SINGLE, acc.data(), 1, nullptr, nullptr) == CEM_ERR_ARG);
+	CHECK(cem_optimize(net, -1, acc.data(), 1, result, nullptr) == CEM_ERR_ARG);
+	CHECK(cem_optimize(net, CEM_FIXED + 1, acc.data(), 1, result, nullptr) == CEM_ERR_ARG);
+	CHECK(cem_optimize(nullptr, CEM_SINGLE, acc.data(), 1, result, nullptr) == CEM_ERR_ARG);
+
+	// fields the model divides by
+	int positive[] = {
+		CEM_IOBUF_SIZE, CEM_IOBUF_RD_BW, CEM_IOBUF_WR_BW,
+		CEM_WEIGHT_SIZE, CEM_WEIGHT_RD_BW, CEM_WEIGHT_WR_BW,
+		CEM_DDR_RD_BW, CEM_DDR_WR_BW, CEM_FIFO_SIZE,
+		CEM_PIXEL_P, CEM_INPUT_MAP_P, CEM_OUTPUT_MAP_P,
+		CEM_MAC_ENE, CEM_MAC_FREQ,
+	};
+	for (int f : positive) {
+		std::vector<double> zero = ValidAccelerator();
+		zero[f] = 0;
+		CheckRejected(net, zero);
+		std::vector<double> neg = ValidAccelerator();
+		neg[f] = -1;
+		CheckRejected(net, neg);
+	}
+
+	// the pinned tier only counts if it is used
+	std::vector<double> pinned = ValidAccelerator();
+	pinned[CEM_PINNED_SIZE] = 0;
+	CHECK(cem_optimize(net, CEM_FIXED, pinned.data(), 1, result, nullptr) == CEM_OK);
+	pinned[CEM_USE_PINNED] = 1;
+	CheckRejected(net, pinned);
+
+	// a valid accelerator
+	CHECK(cem_prepare(net, acc.data(), 1) == CEM_OK);
+	CHECK(cem_evaluate(net, acc.data(), 1, result) == CEM_OK);
+	CHECK(result[CEM_TOTAL] > 0);
+	for (int m = CEM_SINGLE; m <= CEM_FIXED; m++) {
+		CHECK(cem_optimize(net, m, acc.data(), 1, result, &schedule) == CEM_OK);
+		CHECK(result[CEM_TOTAL] > 0 && result[CEM_TIME] > 0);
+	}
+	CHECK(cem_optimize(net, CEM_CROSS, acc.data(), 0, result, nullptr) == CEM_OK);
+
+	cem_net_free(net);
+	return _fail_num;
+}
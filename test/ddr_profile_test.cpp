@@ -0,0 +1,54 @@
+#include "ddr_profile.h"
+#include "device_param.h"
+#include "test_util.h"
+#include <fstream>
+#include <cstdio>
+
+// the DDR model of acc is the one of the constants in device_param.h
+static void CheckDeviceParam(Accelerator &acc)
+{
+	CHECK_NEAR(acc._ddr._rd_bw, DDR_BW, 1e-12);
+	CHECK_NEAR(acc._ddr._wr_bw, DDR_BW, 1e-12);
+	CHECK_NEAR(acc._ddr._unit_rd_ene, DDR_RD_ENE_PER_BYTE, 1e-12);
+	CHECK_NEAR(acc._ddr._unit_wr_ene, DDR_WR_ENE_PER_BYTE, 1e-12);
+	CHECK_NEAR(acc._ddr._bg_pwr, DDR_BG_PWR, 1e-12);
+}
+
+int main()
+{
+	// the default profile, without the row buffer model
+	DDRProfile ddr;
+	CHECK(ddr._channel_num == 1 && ddr._chip_num == DDR_CHIP_NUM);
+	CHECK_NEAR(ddr.Bandwidth(), DDR_BW, 1e-12);
+	Accelerator acc;
+	ddr.Apply(&acc);
+	CheckDeviceParam(acc);
+	CHECK(acc._ddr_row._row_size == 0);
+	CHECK(acc._ddr_row._active_pwr == 0);
+
+	// the profile file of the same device only adds the row buffer
+	DDRProfile ddr3;
+	CHECK(ddr3.LoadFromFile(TEST_PROFILE("ddr3-1600-2x16.txt")));
+	Accelerator acc3;
+	ddr3.Apply(&acc3);
+	CheckDeviceParam(acc3);
+	CHECK(acc3._ddr_row._row_size == 2048 * DDR_CHIP_NUM);
+	CHECK(acc3._ddr_row._act_ene > 0);
+
+	CHECK(!ddr3.LoadFromFile(TEST_PROFILE("no-such-profile.txt")));
+
+	// values the bandwidth or the energy can not be derived from
+	const char *bad[] = {
+		"chip_bw 0", "freq_mhz 0", "chip_num 0", "channel_num -1", "bw_eff 0",
+		"bg_pwr -1", "rd_pwr_ratio -0.5", "chip_bw x",
+	};
+	for (int b = 0; b < sizeof(bad) / sizeof(bad[0]); b++) {
+		std::ofstream os("bad_ddr.txt");
+		os << "name bad\n" << bad[b] << "\n";
+		os.close();
+		DDRProfile p;
+		CHECK(!p.LoadFromFile("bad_ddr.txt"));
+	}
+	std::remove("bad_ddr.txt");
+	return _fail_num;
+}
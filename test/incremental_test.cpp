@@ -0,0 +1,193 @@
+#include "incremental.h"
+#include "optimizer.h"
+#include "ddr_profile.h"
+#include "device_param.h"
+#include "test_util.h"
+#include <cstdio>
+#include <sstream>
+#include <vector>
+
+// VGG-16, and the same with layer 9 cut to a 1x1 kernel without pooling
+static const char *NET_A =
+	"13\n"
+	"224 3 64 3 1 1 0\n"
+	"224 64 64 3 1 1 1 2 2\n"
+	"112 64 128 3 1 1 0\n"
+	"112 64 128 3 1 1 1 2 2\n"
+	"56 128 256 3 1 1 0\n"
+	"56 256 256 3 1 1 1 2 2\n"
+	"56 256 256 3 1 1 1 2 2\n"
+	"28 256 512 3 1 1 0\n"
+	"28 512 512 3 1 1 1 2 2\n"
+	"28 512 512 3 1 1 1 2 2\n"
+	"14 512 512 3 1 1 0\n"
+	"14 512 512 3 1 1 1 2 2\n"
+	"14 512 512 3 1 1 1 2 2\n";
+
+static std::string EditedNet()
+{
+	std::string net = NET_A;
+	std::string from = "28 512 512 3 1 1 1 2 2\n28 512 512 3 1 1 1 2 2\n";
+	std::string to = "28 512 512 3 1 1 1 2 2\n28 512 512 1 1 1 0\n";
+	return net.replace(net.find(from), from.size(), to);
+}
+
+static bool Load(Optimizer &opt, const std::string net)
+{
+	std::istringstream is(net);
+	return opt.LoadNet(is);
+}
+
+// SRAM banks i and j, fifo k, and RRAM r for pinned weights if r >= 0
+static Accelerator MakeAccelerator(int i, int j, int k, int r)
+{
+	Accelerator acc;
+	DDRProfile ddr;
+	ddr.Apply(&acc);
+	BufferModel *bufs[2] = { &acc._iobuf, &acc._weight };
+	int banks[2] = { i, j };
+	for (int b = 0; b < 2; b++) {
+		bufs[b]->_size = SRAM_UNIT_SIZE[banks[b]] * PIXEL_P;
+		bufs[b]->_rd_bw = SRAM_UNIT_RD_BW[banks[b]] * PIXEL_P;
+		bufs[b]->_wr_bw = SRAM_UNIT_WR_BW[banks[b]] * PIXEL_P;
+		bufs[b]->_unit_rd_ene = SRAM_UNIT_RD_ENE[banks[b]];
+		bufs[b]->_unit_wr_ene = SRAM_UNIT_WR_ENE[banks[b]];
+		bufs[b]->_bg_pwr = SRAM_UNIT_BG_PWR[banks[b]] * PIXEL_P;
+	}
+	acc._input_map_p = CHANNEL_P;
+	acc._output_map_p = CHANNEL_P;
+	acc._pixel_p = PIXEL_P;
+	acc._mac_ene = MAC_ENE;
+	acc._mac_freq = MAC_FREQ;
+	acc._acc_buf._size = FIFO_SIZE[k];
+	acc._acc_buf._unit_rd_ene = FIFO_UNIT_RD_ENE[k];
+	acc._acc_buf._unit_wr_ene = FIFO_UNIT_WR_ENE[k];
+	if (r >= 0) {
+		acc._use_pinned = true;
+		acc._pinned._size = RRAM_UNIT_SIZE[r] * PIXEL_P;
+		acc._pinned._rd_bw = RRAM_UNIT_RD_BW[r] * PIXEL_P;
+		acc._pinned._wr_bw = RRAM_UNIT_WR_BW[r] * PIXEL_P;
+		acc._pinned._unit_rd_ene = RRAM_UNIT_RD_ENE[r];
+		acc._pinned._unit_wr_ene = RRAM_UNIT_WR_ENE[r];
+		acc._pinned._bg_pwr = RRAM_UNIT_BG_PWR[r] * PIXEL_P;
+	}
+	return acc;
+}
+
+// the three network optimizations over a few accelerators,
+// configurations first to last - 1
+static std::vector<EnergyModel> RunAll(Optimizer &opt, int first = 0, int last = 6)
+{
+	int configs[6][4] = {
+		{ 0, 0, 0, -1 }, { 2, 1, 1, -1 }, { 4, 4, 2, -1 },
+		{ 1, 0, 0, 2 }, { 3, 2, 1, 4 }, { 4, 1, 3, 0 },
+	};
+	std::vector<EnergyModel> res;
+	std::vector<char> weight_ready(opt._net.size(), 0);
+	for (int c = first; c < last; c++) {
+		Accelerator acc = MakeAccelerator(configs[c][0], configs[c][1], configs[c][2], configs[c][3]);
+		opt.Precompute(&acc);
+		res.push_back(opt.OptNetworkSingle(&acc));
+		res.push_back(opt.OptNetworkCrossLayer(&acc, (bool *)weight_ready.data()));
+		res.push_back(opt.OptNetworkFixedWeights(&acc));
+	}
+	return res;
+}
+
+static bool SameResults(const std::vector<EnergyModel> &a, const std::vector<EnergyModel> &b)
+{
+	if (a.size() != b.size()) {
+		return false;
+	}
+	for (int n = 0; n < a.size(); n++) {
+		EnergyModel x = a[n], y = b[n];
+		if (x.Total() != y.Total() || x._time != y._time || x._schedule != y._schedule) {
+			return false;
+		}
+	}
+	return true;
+}
+
+int main()
+{
+	std::string net_b = EditedNet();
+	Optimizer full_a, full_b;
+	CHECK(Load(full_a, NET_A));
+	CHECK(Load(full_b, net_b));
+	std::vector<EnergyModel> expect_a = RunAll(full_a);
+	std::vector<EnergyModel> expect = RunAll(full_b);
+
+	// the first run has no previous one, the pinnings tried
+	// still share their prefixes
+	std::remove("inc_a.bin");
+	Optimizer opt_a;
+	CHECK(Load(opt_a, NET_A));
+	IncrementalCache cache_a;
+	CHECK(!cache_a.Load("inc_a.bin"));
+	cache_a.Diff(opt_a._net);
+	CHECK(!cache_a.Changed());
+	CHECK(cache_a._reuse_num == 0);
+	opt_a._inc = &cache_a;
+	std::vector<EnergyModel> res_a = RunAll(opt_a);
+	CHECK(SameResults(res_a, expect_a));
+	CHECK(cache_a._prefix_hit > 0);
+	long long entry_num = cache_a.EntryNum();
+	CHECK(entry_num > 0);
+
+	// the same optimizations keep no more entries
+	CHECK(SameResults(RunAll(opt_a), res_a));
+	CHECK(cache_a.EntryNum() == entry_num);
+	CHECK(cache_a.Save("inc_a.bin"));
+
+	// the edited network reuses the prefix and gives the full results
+	Optimizer opt_b;
+	CHECK(Load(opt_b, net_b));
+	IncrementalCache cache_b;
+	CHECK(cache_b.Load("inc_a.bin"));
+	cache_b.Diff(opt_b._net);
+	CHECK(cache_b.Changed());
+	CHECK(cache_b._same_num == 9);
+	CHECK(cache_b._reuse_num == 8);
+	opt_b._inc = &cache_b;
+	CHECK(SameResults(RunAll(opt_b), expect));
+	CHECK(cache_b._prefix_hit > 0);
+
+	// a cache saved in two parts loads both, every DP of the same
+	// network then starts from a kept prefix
+	std::remove("inc_b.bin");
+	IncrementalCache cache_c;
+	cache_c.Diff(opt_b._net);
+	opt_b._inc = &cache_c;
+	RunAll(opt_b, 0, 3);
+	CHECK(cache_c.Save("inc_b.bin"));
+	RunAll(opt_b, 3, 6);
+	CHECK(cache_c.Save("inc_b.bin"));
+	IncrementalCache cache_d;
+	CHECK(cache_d.Load("inc_b.bin"));
+	cache_d.Diff(opt_b._net);
+	CHECK(!cache_d.Changed());
+	opt_b._inc = &cache_d;
+	CHECK(SameResults(RunAll(opt_b), expect));
+	CHECK(cache_d._prefix_hit > 0 && cache_d._prefix_miss == 0);
+	CHECK(cache_b._prefix_miss < cache_c._prefix_miss);
+
+	// the size cap bounds the kept entries, not the results
+	IncrementalCache cache_e;
+	CHECK(cache_e.Load("inc_a.bin"));
+	cache_e._max_size = 0;
+	cache_e.Diff(opt_b._net);
+	opt_b._inc = &cache_e;
+	CHECK(SameResults(RunAll(opt_b), expect));
+	CHECK(cache_e.EntryNum() == 0);
+
+	IncrementalCache cache_f;
+	cache_f._max_size = 4096;
+	cache_f.Diff(opt_b._net);
+	opt_b._inc = &cache_f;
+	CHECK(SameResults(RunAll(opt_b), expect));
+	CHECK(cache_f.EntryNum() < entry_num);
+
+	std::remove("inc_a.bin");
+	std::remove("inc_b.bin");
+	return _fail_num;
+}
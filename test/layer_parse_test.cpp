@@ -0,0 +1,115 @@
+#include "optimizer.h"
+#include "layer.h"
+#include "test_util.h"
+#include <sstream>
+
+// a layer of the extended format, Parse() returns 1 for it
+static Layer ParseLayer(const char *s)
+{
+	Layer l;
+	CHECK(l.Parse(s) == 1);
+	return l;
+}
+
+// weight and MAC totals of MobileNet v1 1.0-224, without the classifier
+// bias, as published
+static void CheckMobileNet()
+{
+	Optimizer opt;
+	opt._verbose = false;
+	CHECK(opt.LoadNetFromFile(TEST_MODEL("mobilenet-v1.txt")));
+	long long weights = 0;
+	double macs = 0;
+	for (int l = 0; l < opt._net.size(); l++) {
+		weights += opt._net[l]->GetWeightSize();
+		macs += opt._net[l]->GetMacNum();
+	}
+	CHECK(weights == 4209088);
+	CHECK(macs == 568740352.0);
+}
+
+static void CheckLayers()
+{
+	CHECK(Layer().Parse("") == 0);
+	CHECK(Layer().Parse("   # a comment") == 0);
+
+	Layer conv = ParseLayer("conv 224x224x3 out=32 k=3 s=2 p=1");
+	int x, y;
+	conv.GetOutputMapShape(x, y);
+	CHECK(x == 112 && y == 112);
+	CHECK(conv.GetWeightSize() == 3 * 3 * 3 * 32);
+
+	// rectangular kernel and padding, grouped convolution
+	Layer group = ParseLayer("conv 20x10x64 out=32 k=5x3 p=2x1 g=4 pool=2/2 # grouped");
+	group.GetConvOutputShape(x, y);
+	CHECK(x == 20 && y == 10);
+	group.GetOutputMapShape(x, y);
+	CHECK(x == 10 && y == 5);
+	CHECK(group.GetWeightSize() == 5 * 3 * 16 * 32);
+
+	// depthwise, with a channel multiplier
+	Layer dw = ParseLayer("dwconv 56x56x128 k=3 s=2 p=1 m=2");
+	CHECK(dw._group == 128 && dw._output_map_num == 256);
+	CHECK(dw.GetWeightSize() == 3 * 3 * 256);
+	CHECK(dw.GetMacNum() == 28.0 * 28 * 3 * 3 * 256);
+
+	// fc flattens its input map
+	Layer fc = ParseLayer("fc 7x7x512 out=4096");
+	CHECK(fc._type == LAYER_FC && fc._input_map_num == 7 * 7 * 512);
+	CHECK(fc._input_map_x == 1 && fc._input_map_y == 1);
+	CHECK(fc.GetWeightSize() == 7 * 7 * 512 * 4096);
+	CHECK(ParseLayer("fc 1024 out=10").GetMacNum() == 10240.0);
+
+	// a pooling layer with padding per axis
+	Layer pool = ParseLayer("pool 13x14x8 k=3 s=2 p=1x0");
+	CHECK(pool._type == LAYER_POOL && pool._is_pooling);
+	CHECK(pool._pool_pad_x == 1 && pool._pool_pad_y == 0);
+	pool.GetOutputMapShape(x, y);
+	CHECK(x == 7 && y == 6);
+	CHECK(pool._output_map_num == 8);
+	CHECK(pool.GetWeightSize() == 0 && pool.GetMacNum() == 0);
+	Layer same = ParseLayer("pool 14x14x8 k=2 s=2 p=same");
+	same.GetOutputMapShape(x, y);
+	CHECK(x == 7 && y == 7);
+
+	// malformed lines, and the dwconv forms that would contradict
+	// the channels it derives
+	const char *bad[] = {
+		"dwconv 56x56x128 k=3 out=128",
+		"dwconv 56x56x128 k=3 g=128",
+		"conv 56x56x128 out=64 m=2",
+		"fc 7x7x512 out=10 m=2",
+		"conv 56x56x128 out=64 g=3",
+		"conv 56x56 out=64",
+		"conv 56x56x128",
+		"conv 56x56x128 out=64 s=0",
+		"conv 56x56x128 out=64 pool=2",
+		"conv 56x56x128 out=64k=3",
+		"deconv 56x56x128 out=64",
+	};
+	for (int b = 0; b < sizeof(bad) / sizeof(bad[0]); b++) {
+		Layer l;
+		CHECK(l.Parse(bad[b]) == -1);
+	}
+}
+
+// the legacy format keeps its "same" padding
+static void CheckLegacy()
+{
+	Optimizer opt;
+	std::istringstream is("2\n224 3 64 3 1 1 0\n224 64 64 3 1 1 1 2 2\n");
+	CHECK(opt.LoadNet(is));
+	CHECK(opt._net.size() == 2);
+	CHECK(opt._net[0]->_pad_x == PAD_SAME && opt._net[1]->_pool_pad_y == PAD_SAME);
+	int x, y;
+	opt._net[1]->GetOutputMapShape(x, y);
+	CHECK(x == 112 && y == 112);
+}
+
+int main()
+{
+	CheckMobileNet();
+	CheckLayers();
+	CheckLegacy();
+	return _fail_num;
+}
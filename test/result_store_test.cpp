@@ -0,0 +1,178 @@
+#include "result_store.h"
+#include "test_util.h"
+#include <cstdio>
+#include <fstream>
+
+static EnergyModel MakeEnergy(int r)
+{
+	EnergyModel ene;
+	ene._rd_iobuf = 1e6 * r + 1;
+	ene._wr_ddr = 2e6 * r + 3;
+	ene._calc = 5e5;
+	ene._time = 10.0 + r;
+	ene._ddr_time = 0.5 * r;
+	ene._schedule = 0x123456789abcdefULL * (r + 1);
+	return ene;
+}
+
+// write rows blocks of block_rows and check they read back
+static void CheckWriteRead(int rows, int block_rows)
+{
+	const std::string fn = "result_store_test.bin";
+	ResultSink sink;
+	CHECK(sink.Open(fn, { "a", "b" }, { "x", "y" }, false, block_rows));
+	for (int r = 0; r < rows; r++) {
+		int keys[2] = { r, -r };
+		EnergyModel ene[2] = { MakeEnergy(r), MakeEnergy(r + 7) };
+		sink.Append(keys, ene);
+	}
+	sink.Close();
+
+	ResultReader reader;
+	CHECK(reader.Open(fn));
+	CHECK(reader.RowNum() == rows);
+	CHECK(reader._cols.size() == 2 + 2 * RESULT_ENE_FIELD_NUM);
+	int a = reader.FindColumn("a");
+	int b = reader.FindColumn("b");
+	int xs = reader.FindColumn("x.schedule");
+	int xt = reader.FindColumn("x.total");
+	int yr = reader.FindColumn("y.rd_iobuf");
+	int yt = reader.FindColumn("y.time");
+	CHECK(a == 0 && b == 1 && xs >= 0 && xt >= 0 && yr >= 0 && yt >= 0);
+	CHECK(reader.FindColumn("z.total") == -1);
+	for (int r = 0; r < rows; r++) {
+		EnergyModel x = MakeEnergy(r);
+		EnergyModel y = MakeEnergy(r + 7);
+		CHECK(reader.GetInt(a, r) == r);
+		CHECK(reader.GetInt(b, r) == -r);
+		CHECK(reader.GetUInt64(xs, r) == x._schedule);
+		CHECK(reader.GetDouble(xt, r) == x.Total() / 1e6);
+		CHECK(reader.GetDouble(yr, r) == y._rd_iobuf / 1e6);
+		CHECK(reader.GetDouble(yt, r) == y._time);
+	}
+
+	// out of range reads
+	CHECK(reader.Locate(a, rows) == nullptr);
+	CHECK(reader.Locate(a, -1) == nullptr);
+	CHECK(reader.Locate(-1, 0) == nullptr);
+	CHECK(reader.Locate(reader._cols.size(), 0) == nullptr);
+	CHECK(reader.GetInt(a, rows) == 0);
+	reader.Close();
+	std::remove(fn.c_str());
+}
+
+// append keeps the rows of a file with the same columns,
+// the default truncates
+static void CheckAppend()
+{
+	const std::string fn = "result_store_append.bin";
+	EnergyModel ene = MakeEnergy(1);
+	for (int run = 0; run < 2; run++) {
+		ResultSink sink;
+		CHECK(sink.Open(fn, { "k" }, { "x" }, true, 2));
+		CHECK(sink.RowNum() == run * 3);
+		for (int k = 0; k < 3; k++) {
+			sink.Append(&k, &ene);
+		}
+	}
+	ResultReader reader;
+	CHECK(reader.Open(fn));
+	CHECK(reader.RowNum() == 6);
+	CHECK(reader.GetInt(0, 4) == 1);
+	reader.Close();
+
+	// other columns can not be appended to
+	ResultSink other;
+	CHECK(!other.Open(fn, { "k", "l" }, { "x" }, true));
+
+	ResultSink sink;
+	CHECK(sink.Open(fn, { "k" }, { "x" }));
+	int k = 9;
+	sink.Append(&k, &ene);
+	sink.Close();
+	CHECK(reader.Open(fn));
+	CHECK(reader.RowNum() == 1);
+	CHECK(reader.GetInt(0, 0) == 9);
+
+	// rows are only copied between files with the same columns
+	ResultSink copy;
+	CHECK(copy.Open("result_store_copy.bin", { "k" }, { "x" }));
+	CHECK(copy.AppendRow(reader, 0));
+	CHECK(!copy.AppendRow(reader, 1));
+	ResultSink copy2;
+	CHECK(copy2.Open("result_store_copy2.bin", { "j" }, { "x" }));
+	CHECK(!copy2.AppendRow(reader, 0));
+	reader.Close();
+	copy.Close();
+	copy2.Close();
+	std::remove(fn.c_str());
+	std::remove("result_store_copy.bin");
+	std::remove("result_store_copy2.bin");
+}
+
+// files of another version are not read
+static void CheckVersion()
+{
+	const std::string fn = "result_store_version.bin";
+	EnergyModel ene;
+	ResultSink sink;
+	CHECK(sink.Open(fn, { "k" }, { "x" }));
+	int k = 0;
+	sink.Append(&k, &ene);
+	sink.Close();
+
+	std::fstream fs(fn, std::ios::in | std::ios::out | std::ios::binary);
+	unsigned int version = 99;
+	fs.seekp(4);
+	fs.write((const char *)&version, 4);
+	fs.close();
+
+	ResultReader reader;
+	CHECK(!reader.Open(fn));
+	std::remove(fn.c_str());
+}
+
+// a block whose row number runs past the end of the file is not read
+static void CheckCorruptRows()
+{
+	const std::string fn = "result_store_corrupt.bin";
+	EnergyModel ene;
+	ResultSink sink;
+	CHECK(sink.Open(fn, { "k" }, { "x" }));
+	sink.Close();
+	ResultReader reader;
+	CHECK(reader.Open(fn));
+	long long header_size = reader.ValidSize();
+	reader.Close();
+
+	unsigned long long bad[] = { 2, 1ULL << 62, ~0ULL, (1ULL << 61) + 1 };
+	for (int b = 0; b < sizeof(bad) / sizeof(bad[0]); b++) {
+		CHECK(sink.Open(fn, { "k" }, { "x" }));
+		int k = 5;
+		sink.Append(&k, &ene);
+		sink.Close();
+
+		std::fstream fs(fn, std::ios::in | std::ios::out | std::ios::binary);
+		fs.seekp(header_size);
+		fs.write((const char *)&bad[b], 8);
+		fs.close();
+
+		CHECK(reader.Open(fn));
+		CHECK(reader.RowNum() == 0);
+		CHECK(reader.ValidSize() == header_size);
+		reader.Close();
+	}
+	std::remove(fn.c_str());
+}
+
+int main()
+{
+	CheckWriteRead(0, 4);
+	CheckWriteRead(1, 4);
+	CheckWriteRead(10, 4);
+	CheckWriteRead(1000, 64);
+	CheckAppend();
+	CheckVersion();
+	CheckCorruptRows();
+	return _fail_num;
+}
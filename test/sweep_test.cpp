@@ -0,0 +1,153 @@
+#include "sweep.h"
+#include "test_util.h"
+#include <cstdio>
+#include <cstring>
+
+static void Eval(const int *keys, EnergyModel *ene)
+{
+	ene[0]._rd_ddr = keys[0] * 1000.0 + keys[1];
+	ene[0]._time = keys[0] + 0.5 * keys[1];
+	ene[0]._schedule = keys[0] * 31 + keys[1] + 1;
+	ene[1]._calc = keys[0] * keys[1];
+}
+
+static SweepDriver MakeSweep()
+{
+	SweepDriver sweep({ "a", "b" }, { 4, 5 }, { "x", "y" });
+	sweep._checkpoint_rows = 3;
+	return sweep;
+}
+
+static void RemoveSweep(SweepDriver &sweep, const std::string prefix)
+{
+	std::remove((prefix + ".bin").c_str());
+	for (int s = 0; s < sweep._shard_num; s++) {
+		std::remove(sweep.ResultFile(prefix, s).c_str());
+		std::remove(sweep.ProgressFile(prefix, s).c_str());
+	}
+}
+
+// the same rows with the same values
+static bool SameResult(const std::string fn1, const std::string fn2)
+{
+	ResultReader r1, r2;
+	if (!r1.Open(fn1) || !r2.Open(fn2) || !r1.SameColumns(r2._cols) ||
+		r1.RowNum() != r2.RowNum()) {
+		return false;
+	}
+	for (long long r = 0; r < r1.RowNum(); r++) {
+		for (int c = 0; c < r1._cols.size(); c++) {
+			if (memcmp(r1.Locate(c, r), r2.Locate(c, r), r1._cols[c].TypeSize()) != 0) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+int main()
+{
+	SweepDriver full = MakeSweep();
+	RemoveSweep(full, "sweep_full");
+	CHECK(full.Run("sweep_full", Eval));
+
+	// the shards merged give the full sweep
+	const int shard_num = 3;
+	SweepDriver merge = MakeSweep();
+	CHECK(merge.SetShard(0, shard_num));
+	RemoveSweep(merge, "sweep_shard");
+	for (int s = 0; s < shard_num; s++) {
+		SweepDriver shard = MakeSweep();
+		CHECK(shard.SetShard(s, shard_num));
+		CHECK(shard.Run("sweep_shard", Eval));
+	}
+	CHECK(merge.Merge("sweep_shard"));
+	CHECK(SameResult("sweep_full.bin", "sweep_shard.bin"));
+
+	// a resumed shard evaluates nothing again
+	SweepDriver resumed = MakeSweep();
+	resumed.SetShard(1, shard_num);
+	int eval_num = 0;
+	CHECK(resumed.Run("sweep_shard", [&](const int *keys, EnergyModel *ene) {
+		eval_num++;
+		Eval(keys, ene);
+	}));
+	CHECK(eval_num == 0);
+	CHECK(merge.Merge("sweep_shard"));
+	CHECK(SameResult("sweep_full.bin", "sweep_shard.bin"));
+
+	// the merged result resumes as the full sweep
+	SweepDriver merged = MakeSweep();
+	CHECK(merged.Run("sweep_shard", [&](const int *keys, EnergyModel *ene) {
+		eval_num++;
+	}));
+	CHECK(eval_num == 0);
+	CHECK(SameResult("sweep_full.bin", "sweep_shard.bin"));
+
+	// a merge of one shard would read the file it writes
+	SweepDriver one = MakeSweep();
+	CHECK(!one.Merge("sweep_full"));
+	CHECK(SameResult("sweep_full.bin", "sweep_shard.bin"));
+
+	// the files of another run are not resumed or merged
+	SweepDriver other_run = MakeSweep();
+	other_run._run_desc = "ddr=other";
+	CHECK(!other_run.Run("sweep_full", Eval));
+	std::remove(other_run.ProgressFile("sweep_full", 0).c_str());
+	CHECK(!other_run.Run("sweep_full", Eval));
+	CHECK(SameResult("sweep_full.bin", "sweep_shard.bin"));
+	CHECK(other_run.SetShard(0, shard_num));
+	CHECK(!other_run.Merge("sweep_shard"));
+
+	// a progress log without results is stale
+	SweepDriver fresh = MakeSweep();
+	fresh._run_desc = "ddr=other";
+	CHECK(fresh.Run("sweep_fresh", Eval));
+	std::remove("sweep_fresh.bin");
+	eval_num = 0;
+	CHECK(fresh.Run("sweep_fresh", [&](const int *keys, EnergyModel *ene) {
+		eval_num++;
+		Eval(keys, ene);
+	}));
+	CHECK(eval_num == fresh.PointNum());
+	RemoveSweep(fresh, "sweep_fresh");
+
+	// bad shards
+	SweepDriver bad = MakeSweep();
+	CHECK(!bad.SetShard(3, 0));
+	CHECK(!bad.SetShard(0, 0));
+	CHECK(!bad.SetShard(0, -2));
+	CHECK(!bad.SetShard(-1, 2));
+	CHECK(!bad.SetShard(2, 2));
+	CHECK(bad._shard_id == 0 && bad._shard_num == 1);
+
+	// a missing shard fails the merge and keeps the last merged result
+	std::remove(merge.ResultFile("sweep_shard", 2).c_str());
+	CHECK(!merge.Merge("sweep_shard"));
+	CHECK(SameResult("sweep_full.bin", "sweep_shard.bin"));
+
+	// so does a shard with other columns
+	ResultSink other;
+	other._desc = merge.Fingerprint();
+	CHECK(other.Open(merge.ResultFile("sweep_shard", 2), { "point", "a" }, { "x", "y" }));
+	other.Close();
+	CHECK(!merge.Merge("sweep_shard"));
+
+	// and grid points out of the grid, which also stop a resume
+	ResultSink outside;
+	outside._desc = merge.Fingerprint();
+	CHECK(outside.Open(merge.ResultFile("sweep_shard", 2), { "point", "a", "b" }, { "x", "y" }));
+	int keys[3] = { 1000, 0, 0 };
+	EnergyModel ene[2];
+	outside.Append(keys, ene);
+	outside.Close();
+	CHECK(!merge.Merge("sweep_shard"));
+	SweepDriver shard2 = MakeSweep();
+	shard2.SetShard(2, shard_num);
+	std::remove(shard2.ProgressFile("sweep_shard", 2).c_str());
+	CHECK(!shard2.Run("sweep_shard", Eval));
+
+	RemoveSweep(full, "sweep_full");
+	RemoveSweep(merge, "sweep_shard");
+	return _fail_num;
+}
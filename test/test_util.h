@@ -0,0 +1,21 @@
+#pragma once
+#include <iostream>
+#include <cmath>
+
+// minimal checks for the test programs, a test returns the
+// number of failed checks
+
+#define CHECK(X) do { \
+	if (!(X)) { \
+		std::cout << __FILE__ << ":" << __LINE__ << ": CHECK(" #X ") failed" << std::endl; \
+		_fail_num++; \
+	} \
+} while (0)
+
+#define CHECK_NEAR(X, Y, TOL) CHECK(std::fabs((X) - (Y)) <= (TOL) * (std::fabs(Y) + 1e-12))
+
+static int _fail_num = 0;
+
+// model files of the source tree
+#define TEST_MODEL(NAME) (std::string(CEM_SOURCE_DIR) + "/model/" NAME)
+#define TEST_PROFILE(NAME) (std::string(CEM_SOURCE_DIR) + "/profile/" NAME)